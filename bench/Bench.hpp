@@ -0,0 +1,893 @@
+#ifndef __lock_bench_bench_hpp_defined
+#define __lock_bench_bench_hpp_defined
+
+/* Shared utilities of the benchmark programs: argument parsing, worker threads, latency histograms, and a uniform interface to the library and to the baseline locks it is compared against. */
+
+#include <Lock/Lock.hpp>
+
+#include <pthread.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace bench
+{
+	/** Returns the current time of a monotonic clock, in nanoseconds. */
+	inline std::uint64_t now()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	/** Reads the CPU's time stamp counter, or the monotonic clock in nanoseconds where there is none.
+		Much cheaper than `now()`, but needs a constant rate counter (any x86-64 CPU of the last decade). Convert with `ticks_per_ns()`. */
+	inline std::uint64_t ticks()
+	{
+#if defined(__x86_64__) || defined(__i386__)
+		return __builtin_ia32_rdtsc();
+#elif defined(__aarch64__)
+		std::uint64_t value;
+		__asm__ __volatile__("mrs %0, cntvct_el0" : "=r"(value));
+		return value;
+#else
+		return now();
+#endif
+	}
+
+	/** Returns the rate of `ticks()`, measured against the monotonic clock on the first call (takes 50 ms). */
+	inline double ticks_per_ns()
+	{
+		static double const rate = []{
+			std::uint64_t const start_ns = now(), start = ticks();
+			std::this_thread::sleep_for(std::chrono::milliseconds(50));
+			return double(ticks() - start) / double(now() - start_ns);
+		}();
+		return rate;
+	}
+
+	/** Keeps the compiler from optimising away the computation of a value. */
+	inline void keep(
+		std::uint64_t value)
+	{
+		static std::atomic<std::uint64_t> sink(0);
+		sink.store(value, std::memory_order_relaxed);
+	}
+
+	/** Simulates work, e.g., within a critical section.
+	@param[in] units:
+		How long to work. Each unit is a short dependent arithmetic chain, so it takes roughly the same time on every core. */
+	inline void work(
+		unsigned units)
+	{
+		std::uint64_t x = units;
+		for(unsigned i = 0; i < units; i++)
+			for(unsigned j = 0; j < 8; j++)
+				x = x * 6364136223846793005ull + 1442695040888963407ull;
+		if(x == 42)
+			keep(x);
+	}
+
+	/** Returns the upper 64 bits of the 128 bit product `a * b`, from 32 bit halves. */
+	inline std::uint64_t multiply_high(
+		std::uint64_t a,
+		std::uint64_t b)
+	{
+		std::uint64_t const a_low = a & 0xFFFFFFFFu, a_high = a >> 32;
+		std::uint64_t const b_low = b & 0xFFFFFFFFu, b_high = b >> 32;
+		std::uint64_t const low = a_low * b_low;
+		std::uint64_t const middle1 = a_high * b_low + (low >> 32);
+		std::uint64_t const middle2 = a_low * b_high + (middle1 & 0xFFFFFFFFu);
+		return a_high * b_high + (middle1 >> 32) + (middle2 >> 32);
+	}
+
+	/** Small and fast pseudo random number generator (xorshift64*). */
+	class Random
+	{
+		std::uint64_t m_state;
+	public:
+		/** Creates a generator.
+		@param[in] seed:
+			The seed, distinct per thread. */
+		explicit Random(
+			std::uint64_t seed):
+			m_state(seed * 0x9E3779B97F4A7C15ull | 1)
+		{
+		}
+
+		/** Returns the next random number. */
+		std::uint64_t next()
+		{
+			m_state ^= m_state >> 12;
+			m_state ^= m_state << 25;
+			m_state ^= m_state >> 27;
+			return m_state * 0x2545F4914F6CDD1Dull;
+		}
+
+		/** Returns a random number in `[0, bound)`. */
+		std::uint64_t below(
+			std::uint64_t bound)
+		{
+			return multiply_high(next(), bound);
+		}
+
+		/** Returns a random number in `[0, 1)`. */
+		double unit()
+		{
+			return (next() >> 11) * (1.0 / 9007199254740992.0);
+		}
+	};
+
+	/** Zipfian distribution over `[0, n)`: value `i` is drawn with a probability proportional to `1 / (i + 1)^skew`.
+		Skew 0 is uniform, around 1 a few values are very hot. */
+	class Zipf
+	{
+		std::vector<double> m_cdf;
+	public:
+		Zipf(
+			std::size_t n,
+			double skew):
+			m_cdf(n)
+		{
+			double sum = 0;
+			for(std::size_t i = 0; i < n; i++)
+				m_cdf[i] = sum += std::pow(double(i + 1), -skew);
+			for(double &p : m_cdf)
+				p /= sum;
+		}
+
+		/** Draws a value. */
+		std::size_t operator()(
+			Random &random) const
+		{
+			std::size_t const i = std::upper_bound(m_cdf.begin(), m_cdf.end(), random.unit()) - m_cdf.begin();
+			return std::min(i, m_cdf.size() - 1);
+		}
+	};
+
+	/** Returns Jain's fairness index of the given amounts: 1 if all are equal, down to `1 / n` if one has everything. */
+	template<class T>
+	double jain(
+		std::vector<T> const& amounts)
+	{
+		long double sum = 0, squares = 0;
+		for(T const& amount : amounts)
+		{
+			sum += amount;
+			squares += (long double) amount * amount;
+		}
+		return squares
+			? double(sum * sum / (amounts.size() * squares))
+			: 1;
+	}
+
+	/** Command line arguments of the form `--name=value` or `--name=value,value,...`. */
+	class Arguments
+	{
+		std::vector<std::pair<std::string, std::string>> m_values;
+	public:
+		Arguments(
+			int argc,
+			char ** argv)
+		{
+			for(int i = 1; i < argc; i++)
+			{
+				char const * arg = argv[i];
+				if(std::strncmp(arg, "--", 2) || !std::strchr(arg, '='))
+				{
+					std::fprintf(stderr, "ignoring argument '%s', expected --name=value.\n", arg);
+					continue;
+				}
+				char const * eq = std::strchr(arg, '=');
+				m_values.emplace_back(std::string(arg + 2, eq), std::string(eq + 1));
+			}
+		}
+
+		/** Returns whether an argument was given. */
+		bool has(
+			char const * name) const
+		{
+			for(auto const& value : m_values)
+				if(value.first == name)
+					return true;
+			return false;
+		}
+
+		/** Returns an argument's text, or `fallback` if it was not given. */
+		std::string text(
+			char const * name,
+			char const * fallback) const
+		{
+			for(auto const& value : m_values)
+				if(value.first == name)
+					return value.second;
+			return fallback;
+		}
+
+		/** Returns an argument's number, or `fallback` if it was not given. */
+		double number(
+			char const * name,
+			double fallback) const
+		{
+			return has(name)
+				? std::strtod(text(name, "").c_str(), nullptr)
+				: fallback;
+		}
+
+		/** Returns an argument's comma separated numbers, or `fallback` if it was not given. */
+		std::vector<double> numbers(
+			char const * name,
+			std::vector<double> fallback) const
+		{
+			if(!has(name))
+				return fallback;
+
+			std::vector<double> numbers;
+			std::string const list = text(name, "");
+			for(char const * it = list.c_str(); *it;)
+			{
+				char * end;
+				numbers.push_back(std::strtod(it, &end));
+				it = *end ? end + 1 : end;
+			}
+			return numbers;
+		}
+
+		/** Returns whether a comma separated argument contains `item`, or true if it was not given. */
+		bool selects(
+			char const * name,
+			char const * item) const
+		{
+			if(!has(name))
+				return true;
+			std::string const list = "," + text(name, "") + ",";
+			return list.find("," + std::string(item) + ",") != std::string::npos;
+		}
+	};
+
+	/** Log-linear latency histogram.
+		Values below `2 * sub_buckets` are counted exactly, larger values with a relative error below `1 / sub_buckets`. Histograms of different threads can be merged. */
+	class Histogram
+	{
+	public:
+		/** log2 of the number of buckets per power of two. */
+		static constexpr unsigned sub_bucket_bits = 7;
+		static constexpr std::uint64_t sub_buckets = std::uint64_t(1) << sub_bucket_bits;
+		/** The number of buckets, covering all 64-bit values. */
+		static constexpr std::size_t bucket_count = (64 - sub_bucket_bits + 1) * sub_buckets;
+
+	private:
+		std::vector<std::uint64_t> m_counts;
+		std::uint64_t m_total;
+		std::uint64_t m_min;
+		std::uint64_t m_max;
+		long double m_sum;
+
+	public:
+		Histogram():
+			m_counts(bucket_count, 0),
+			m_total(0),
+			m_min(~std::uint64_t(0)),
+			m_max(0),
+			m_sum(0)
+		{
+		}
+
+		/** Returns the bucket of a value. */
+		static std::size_t bucket(
+			std::uint64_t value)
+		{
+			if(value < 2 * sub_buckets)
+				return value;
+			unsigned const shift = 63 - __builtin_clzll(value) - sub_bucket_bits;
+			return shift * sub_buckets + (value >> shift);
+		}
+
+		/** Returns the smallest value counted by a bucket. */
+		static std::uint64_t lowest(
+			std::size_t bucket)
+		{
+			if(bucket < 2 * sub_buckets)
+				return bucket;
+			unsigned const shift = bucket / sub_buckets - 1;
+			return (bucket - shift * sub_buckets) << shift;
+		}
+
+		/** Returns the largest value counted by a bucket. */
+		static std::uint64_t highest(
+			std::size_t bucket)
+		{
+			return bucket + 1 == bucket_count
+				? ~std::uint64_t(0)
+				: lowest(bucket + 1) - 1;
+		}
+
+		/** Records a value. */
+		void record(
+			std::uint64_t value,
+			std::uint64_t count = 1)
+		{
+			m_counts[bucket(value)] += count;
+			m_total += count;
+			m_sum += (long double) value * count;
+			m_min = std::min(m_min, value);
+			m_max = std::max(m_max, value);
+		}
+
+		/** Adds another histogram's values. */
+		void merge(
+			Histogram const& other)
+		{
+			for(std::size_t i = 0; i < bucket_count; i++)
+				m_counts[i] += other.m_counts[i];
+			m_total += other.m_total;
+			m_sum += other.m_sum;
+			m_min = std::min(m_min, other.m_min);
+			m_max = std::max(m_max, other.m_max);
+		}
+
+		/** Removes all values. */
+		void clear()
+		{
+			*this = Histogram();
+		}
+
+		/** The number of recorded values. */
+		std::uint64_t total() const { return m_total; }
+		/** The smallest recorded value, or 0 if empty. */
+		std::uint64_t min() const { return m_total ? m_min : 0; }
+		/** The largest recorded value. */
+		std::uint64_t max() const { return m_max; }
+		/** The mean of the recorded values. */
+		double mean() const { return m_total ? double(m_sum / m_total) : 0; }
+		/** The number of values recorded into a bucket. */
+		std::uint64_t count(
+			std::size_t bucket) const { return m_counts[bucket]; }
+
+		/** Returns an upper bound of a percentile of the recorded values.
+		@param[in] percentile:
+			The percentile, between 0 and 1. */
+		std::uint64_t percentile(
+			double percentile) const
+		{
+			if(!m_total)
+				return 0;
+			std::uint64_t const rank = std::max<std::uint64_t>(1,
+				(std::uint64_t) std::ceil(percentile * m_total));
+			std::uint64_t seen = 0;
+			for(std::size_t i = 0; i < bucket_count; i++)
+				if((seen += m_counts[i]) >= rank)
+					return std::min(highest(i), m_max);
+			return m_max;
+		}
+
+		/** Returns the standard deviation of the recorded values, using the buckets' midpoints. */
+		double deviation() const
+		{
+			if(!m_total)
+				return 0;
+			double const average = mean();
+			long double squares = 0;
+			for(std::size_t i = 0; i < bucket_count; i++)
+				if(m_counts[i])
+				{
+					double const delta = (lowest(i) + (highest(i) - lowest(i)) / 2.0) - average;
+					squares += (long double) delta * delta * m_counts[i];
+				}
+			return std::sqrt(double(squares / m_total));
+		}
+
+		/** Prints the percentile distribution in HdrHistogram's format.
+			Percentiles are halved towards 100% in `ticks` steps per half, so the tail is shown in increasing detail.
+		@param[in] out:
+			The output file.
+		@param[in] unit:
+			The printed values are the recorded values divided by `unit`.
+		@param[in] ticks:
+			The number of percentiles per halving of the distance to 100%. */
+		void print(
+			std::FILE * out,
+			double unit,
+			unsigned ticks = 5) const
+		{
+			std::fprintf(out, "%12s %14s %10s %14s\n\n", "Value", "Percentile", "TotalCount", "1/(1-Percentile)");
+			if(m_total)
+			{
+				std::uint64_t seen = 0;
+				std::size_t i = 0;
+				for(double p = 0;;)
+				{
+					std::uint64_t const rank = std::max<std::uint64_t>(1, (std::uint64_t) std::ceil(p * m_total));
+					for(; seen < rank; i++)
+						seen += m_counts[i];
+					double const value = std::min(highest(i - 1), m_max) / unit;
+					if(seen == m_total)
+					{
+						std::fprintf(out, "%12.3f %14.12f %10llu\n", value, 1.0, (unsigned long long) seen);
+						break;
+					}
+					std::fprintf(out, "%12.3f %14.12f %10llu %14.2f\n", value, p, (unsigned long long) seen, 1 / (1 - p));
+					p += 1 / (ticks * std::ldexp(1.0, int(std::floor(std::log2(1 / (1 - p)))) + 1));
+				}
+			}
+			std::fprintf(out, "#[Mean    = %12.3f, StdDeviation   = %12.3f]\n", mean() / unit, deviation() / unit);
+			std::fprintf(out, "#[Max     = %12.3f, Total count    = %12llu]\n", m_max / unit, (unsigned long long) m_total);
+			std::fprintf(out, "#[Buckets = %12zu, SubBuckets     = %12llu]\n", std::size_t(64 - sub_bucket_bits + 1), (unsigned long long) sub_buckets);
+		}
+
+		/** Writes the histogram to a text file that `load()` can merge.
+			The format is a `# lock-histogram` header line, a line `total min max sum`, and one `lowest count` line per non-empty bucket.
+		@return
+			Whether the file could be written. */
+		bool save(
+			char const * path) const
+		{
+			std::FILE * out = std::fopen(path, "w");
+			if(!out)
+				return false;
+			std::fprintf(out, "# lock-histogram %u\n", sub_bucket_bits);
+			std::fprintf(out, "%llu %llu %llu %.0Lf\n",
+				(unsigned long long) m_total,
+				(unsigned long long) min(),
+				(unsigned long long) m_max,
+				m_sum);
+			for(std::size_t i = 0; i < bucket_count; i++)
+				if(m_counts[i])
+					std::fprintf(out, "%llu %llu\n",
+						(unsigned long long) lowest(i),
+						(unsigned long long) m_counts[i]);
+			return std::fclose(out) == 0;
+		}
+
+		/** Adds the values of a histogram file written by `save()`.
+		@return
+			Whether the file could be read. */
+		bool load(
+			char const * path)
+		{
+			std::FILE * in = std::fopen(path, "r");
+			if(!in)
+				return false;
+
+			Histogram loaded;
+			unsigned bits;
+			unsigned long long total, min, max, value, count;
+			bool ok = std::fscanf(in, "# lock-histogram %u", &bits) == 1
+				&& bits == sub_bucket_bits
+				&& std::fscanf(in, "%llu %llu %llu %Lf", &total, &min, &max, &loaded.m_sum) == 4;
+			if(ok)
+			{
+				while(std::fscanf(in, "%llu %llu", &value, &count) == 2)
+					loaded.m_counts[bucket(value)] += count;
+				loaded.m_total = total;
+				loaded.m_min = total ? min : ~std::uint64_t(0);
+				loaded.m_max = max;
+				merge(loaded);
+			}
+			std::fclose(in);
+			return ok;
+		}
+	};
+
+	/** Runs worker threads for a fixed duration.
+		The workers are released at the same time, and should loop until `stop` is set.
+	@param[in] threads:
+		How many worker threads to run.
+	@param[in] duration:
+		How long to run.
+	@param[in] worker:
+		Called as `worker(thread_index, stop)` on each worker thread.
+	@return
+		The time between releasing the workers and stopping them, in seconds. */
+	template<class Worker>
+	double run(
+		unsigned threads,
+		std::chrono::milliseconds duration,
+		Worker &&worker)
+	{
+		std::atomic<bool> stop(false);
+		std::atomic<unsigned> ready(0);
+		std::atomic<bool> go(false);
+		std::vector<std::thread> workers;
+		workers.reserve(threads);
+
+		for(unsigned t = 0; t < threads; t++)
+			workers.emplace_back([&, t]{
+				ready.fetch_add(1);
+				while(!go.load(std::memory_order_acquire))
+					std::this_thread::yield();
+				worker(t, stop);
+			});
+
+		while(ready.load() != threads)
+			std::this_thread::yield();
+		std::uint64_t const start = now();
+		go.store(true, std::memory_order_release);
+		std::this_thread::sleep_for(duration);
+		stop.store(true);
+		std::uint64_t const end = now();
+
+		for(auto &thread : workers)
+			thread.join();
+		return (end - start) * 1e-9;
+	}
+
+	/** Uniform interfaces to the library and to the baseline locks.
+		Every engine guards a `T` and provides:
+		* `read(fn)` / `write(fn)`: lock, call `fn` with the object, unlock.
+		* `try_read(fn)` / `try_write(fn)`: the same if the lock is free, returns whether it was.
+		* `static read_all(set, fn)` / `static write_all(set, fn)`: lock all engines in `set` at once, call `fn` with each object, unlock. The set must not contain duplicates. */
+	namespace engine
+	{
+		template<class Engine>
+		/** The benchmark name of a `lock::ThreadSafe` with the given lock engine. */
+		struct library_name { static constexpr char const * value = "lock"; };
+		template<>
+		struct library_name<lock::engine::Spin> { static constexpr char const * value = "lock-spin"; };
+		template<>
+		struct library_name<lock::engine::Queue> { static constexpr char const * value = "lock-queue"; };
+
+		template<class T, class Layout = lock::layout::Compact, class Engine = lock::engine::Futex>
+		/** `lock::ThreadSafe`, sets are locked via `lock::range_lock()`. */
+		class Library
+		{
+			lock::ThreadSafe<T, Layout, Engine> m_resource;
+		public:
+			static constexpr char const * name = library_name<Engine>::value;
+
+			template<class ...Args>
+			explicit Library(
+				Args&&... args):
+				m_resource(std::forward<Args>(args)...)
+			{
+			}
+
+			lock::ThreadSafe<T, Layout, Engine> &resource() { return m_resource; }
+
+			template<class Fn>
+			void read(Fn &&fn)
+			{
+				lock::ReadLock<T, Layout, Engine> l = m_resource.read();
+				fn(*l);
+			}
+			template<class Fn>
+			void write(Fn &&fn)
+			{
+				lock::WriteLock<T, Layout, Engine> l = m_resource.write();
+				fn(*l);
+			}
+			template<class Fn>
+			bool try_read(Fn &&fn)
+			{
+				lock::ReadLock<T, Layout, Engine> l = m_resource.try_read();
+				if(!l)
+					return false;
+				fn(*l);
+				return true;
+			}
+			template<class Fn>
+			bool try_write(Fn &&fn)
+			{
+				lock::WriteLock<T, Layout, Engine> l = m_resource.try_write();
+				if(!l)
+					return false;
+				fn(*l);
+				return true;
+			}
+
+			template<class Fn>
+			static void read_all(
+				std::vector<Library *> const& set,
+				Fn &&fn)
+			{
+				std::vector<lock::ReadLock<T, Layout, Engine>> locks(set.size());
+				std::vector<lock::ReadLockPair<T, Layout, Engine>> pairs;
+				pairs.reserve(set.size());
+				for(std::size_t i = 0; i < set.size(); i++)
+					pairs.push_back(lock::pair(locks[i], set[i]->m_resource));
+				lock::range_lock(lock::range(pairs.begin(), pairs.end()));
+				for(auto &l : locks)
+					fn(*l);
+			}
+			template<class Fn>
+			static void write_all(
+				std::vector<Library *> const& set,
+				Fn &&fn)
+			{
+				std::vector<lock::WriteLock<T, Layout, Engine>> locks(set.size());
+				std::vector<lock::WriteLockPair<T, Layout, Engine>> pairs;
+				pairs.reserve(set.size());
+				for(std::size_t i = 0; i < set.size(); i++)
+					pairs.push_back(lock::pair(locks[i], set[i]->m_resource));
+				lock::range_lock(lock::range(pairs.begin(), pairs.end()));
+				for(auto &l : locks)
+					fn(*l);
+			}
+		};
+
+		template<class T>
+		/** `Library` with the default layout, for use as a template template argument. */
+		using Lock = Library<T>;
+
+		template<class T>
+		/** `Library` with the queue lock engine. */
+		using QueueLock = Library<T, lock::layout::Compact, lock::engine::Queue>;
+
+		/** Locks a set of baseline engines in address order, calls `fn` with each object, and unlocks them. */
+		template<class Engine, class Lock, class Unlock, class Fn>
+		void ordered(
+			std::vector<Engine *> const& set,
+			Lock &&lock,
+			Unlock &&unlock,
+			Fn &&fn)
+		{
+			std::vector<Engine *> sorted(set);
+			std::sort(sorted.begin(), sorted.end(), std::less<Engine *>());
+			for(Engine * engine : sorted)
+				lock(*engine);
+			for(Engine * engine : set)
+				fn(engine->value);
+			for(auto it = sorted.rbegin(); it != sorted.rend(); it++)
+				unlock(**it);
+		}
+
+		template<class T>
+		/** `std::mutex`, readers are exclusive too. Sets are locked in address order. */
+		struct Mutex
+		{
+			static constexpr char const * name = "std::mutex";
+			std::mutex mutex;
+			T value;
+
+			template<class ...Args>
+			explicit Mutex(
+				Args&&... args):
+				value(std::forward<Args>(args)...)
+			{
+			}
+
+			template<class Fn>
+			void read(Fn &&fn) { write(fn); }
+			template<class Fn>
+			void write(Fn &&fn)
+			{
+				std::lock_guard<std::mutex> l(mutex);
+				fn(value);
+			}
+			template<class Fn>
+			bool try_read(Fn &&fn) { return try_write(fn); }
+			template<class Fn>
+			bool try_write(Fn &&fn)
+			{
+				if(!mutex.try_lock())
+					return false;
+				fn(value);
+				mutex.unlock();
+				return true;
+			}
+
+			template<class Fn>
+			static void read_all(
+				std::vector<Mutex *> const& set,
+				Fn &&fn) { write_all(set, fn); }
+			template<class Fn>
+			static void write_all(
+				std::vector<Mutex *> const& set,
+				Fn &&fn)
+			{
+				ordered(set,
+					[](Mutex &m) { m.mutex.lock(); },
+					[](Mutex &m) { m.mutex.unlock(); },
+					fn);
+			}
+		};
+
+		template<class T>
+		/** `std::shared_mutex`. Sets are locked in address order. */
+		struct SharedMutex
+		{
+			static constexpr char const * name = "std::shared_mutex";
+			std::shared_mutex mutex;
+			T value;
+
+			template<class ...Args>
+			explicit SharedMutex(
+				Args&&... args):
+				value(std::forward<Args>(args)...)
+			{
+			}
+
+			template<class Fn>
+			void read(Fn &&fn)
+			{
+				std::shared_lock<std::shared_mutex> l(mutex);
+				fn(const_cast<T const&>(value));
+			}
+			template<class Fn>
+			void write(Fn &&fn)
+			{
+				std::lock_guard<std::shared_mutex> l(mutex);
+				fn(value);
+			}
+			template<class Fn>
+			bool try_read(Fn &&fn)
+			{
+				if(!mutex.try_lock_shared())
+					return false;
+				fn(const_cast<T const&>(value));
+				mutex.unlock_shared();
+				return true;
+			}
+			template<class Fn>
+			bool try_write(Fn &&fn)
+			{
+				if(!mutex.try_lock())
+					return false;
+				fn(value);
+				mutex.unlock();
+				return true;
+			}
+
+			template<class Fn>
+			static void read_all(
+				std::vector<SharedMutex *> const& set,
+				Fn &&fn)
+			{
+				ordered(set,
+					[](SharedMutex &m) { m.mutex.lock_shared(); },
+					[](SharedMutex &m) { m.mutex.unlock_shared(); },
+					fn);
+			}
+			template<class Fn>
+			static void write_all(
+				std::vector<SharedMutex *> const& set,
+				Fn &&fn)
+			{
+				ordered(set,
+					[](SharedMutex &m) { m.mutex.lock(); },
+					[](SharedMutex &m) { m.mutex.unlock(); },
+					fn);
+			}
+		};
+
+		template<class T>
+		/** `pthread_rwlock_t` with default attributes. Sets are locked in address order. */
+		struct RwLock
+		{
+			static constexpr char const * name = "pthread_rwlock";
+			pthread_rwlock_t rwlock;
+			T value;
+
+			template<class ...Args>
+			explicit RwLock(
+				Args&&... args):
+				value(std::forward<Args>(args)...)
+			{
+				pthread_rwlock_init(&rwlock, nullptr);
+			}
+			~RwLock()
+			{
+				pthread_rwlock_destroy(&rwlock);
+			}
+			RwLock(
+				RwLock const&) = delete;
+			RwLock &operator=(
+				RwLock const&) = delete;
+
+			template<class Fn>
+			void read(Fn &&fn)
+			{
+				pthread_rwlock_rdlock(&rwlock);
+				fn(const_cast<T const&>(value));
+				pthread_rwlock_unlock(&rwlock);
+			}
+			template<class Fn>
+			void write(Fn &&fn)
+			{
+				pthread_rwlock_wrlock(&rwlock);
+				fn(value);
+				pthread_rwlock_unlock(&rwlock);
+			}
+			template<class Fn>
+			bool try_read(Fn &&fn)
+			{
+				if(pthread_rwlock_tryrdlock(&rwlock))
+					return false;
+				fn(const_cast<T const&>(value));
+				pthread_rwlock_unlock(&rwlock);
+				return true;
+			}
+			template<class Fn>
+			bool try_write(Fn &&fn)
+			{
+				if(pthread_rwlock_trywrlock(&rwlock))
+					return false;
+				fn(value);
+				pthread_rwlock_unlock(&rwlock);
+				return true;
+			}
+
+			template<class Fn>
+			static void read_all(
+				std::vector<RwLock *> const& set,
+				Fn &&fn)
+			{
+				ordered(set,
+					[](RwLock &l) { pthread_rwlock_rdlock(&l.rwlock); },
+					[](RwLock &l) { pthread_rwlock_unlock(&l.rwlock); },
+					fn);
+			}
+			template<class Fn>
+			static void write_all(
+				std::vector<RwLock *> const& set,
+				Fn &&fn)
+			{
+				ordered(set,
+					[](RwLock &l) { pthread_rwlock_wrlock(&l.rwlock); },
+					[](RwLock &l) { pthread_rwlock_unlock(&l.rwlock); },
+					fn);
+			}
+		};
+	}
+
+	namespace detail
+	{
+		template<class T, class Benchmark>
+		void each_engine(
+			Arguments const&,
+			Benchmark &&)
+		{
+		}
+
+		template<class T, template<class> class Engine, template<class> class ...Rest, class Benchmark>
+		void each_engine(
+			Arguments const& args,
+			Benchmark &&benchmark)
+		{
+			if(args.selects("engines", Engine<T>::name))
+				benchmark((Engine<T> *) nullptr);
+			each_engine<T, Rest...>(args, benchmark);
+		}
+	}
+
+	template<class T, template<class> class ...Engines, class Benchmark>
+	/** Runs a benchmark for each selected engine.
+		Engines are selected by name with `--engines=lock,std::mutex,...`; all engines run if it is not given.
+	@param[in] args:
+		The command line arguments.
+	@param[in] benchmark:
+		Called as `benchmark(tag)` for each selected engine, where `tag` is a null pointer to the engine type. */
+	void for_engines(
+		Arguments const& args,
+		Benchmark &&benchmark)
+	{
+		detail::each_engine<T, Engines...>(args, benchmark);
+	}
+
+	template<class T, class Benchmark>
+	/** Runs a benchmark for the library and all baseline engines (see `for_engines()`). */
+	void for_all_engines(
+		Arguments const& args,
+		Benchmark &&benchmark)
+	{
+		for_engines<T,
+			engine::Lock,
+			engine::QueueLock,
+			engine::Mutex,
+			engine::SharedMutex,
+			engine::RwLock>(args, benchmark);
+	}
+}
+
+#endif
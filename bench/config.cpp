@@ -0,0 +1,262 @@
+/* Read-mostly configuration object: many readers per request, one control thread updating it in bursts.
+
+Reader threads read --read-words words of the configuration per request, without pausing. A control thread sleeps for --interval milliseconds, then performs a burst of --burst back to back updates, each modifying one word.
+
+Reported per mode, reader count and configuration size:
+	reader throughput (requests/s),
+	reader p50 / p99 / p99.9 latency outside of and during writer bursts,
+	writer acquisition p50 / p99 / max latency (until the update could start), and the mean duration of a whole update.
+
+Modes (select with --modes=...):
+	lock:           lock::ThreadSafe read() / write().
+	sharded:        lock::ShardedThreadSafe read() / write().
+	rcu:            lock::RcuThreadSafe read() / update() (copies the configuration per update).
+	leftright:      lock::LeftRight read() / update() (applies every update to two replicas).
+	shared_mutex:   std::shared_mutex.
+	pthread_rwlock: pthread_rwlock_t.
+Add new read-optimized modes as a struct with `name`, `read(fn)` and `write(fn)`.
+
+Build and run:
+	c++ -std=c++17 -O2 -pthread -Iinclude bench/config.cpp -o config
+	./config [--modes=...] [--readers=8,64,256] [--size=4096] [--read-words=8]
+		[--interval=10] [--burst=10] [--ms=1000] */
+
+#include "Bench.hpp"
+
+#include <Lock/LeftRight.hpp>
+#include <Lock/RcuThreadSafe.hpp>
+#include <Lock/ShardedThreadSafe.hpp>
+
+/** The configuration object. */
+struct Config
+{
+	std::vector<std::uint64_t> words;
+
+	explicit Config(
+		std::size_t bytes):
+		words(std::max<std::size_t>(1, bytes / sizeof(std::uint64_t)), 1)
+	{
+	}
+};
+
+/** The modes, each guards a `Config` and provides `read(fn)` and `write(fn)`. */
+namespace mode
+{
+	struct Lock
+	{
+		static constexpr char const * name = "lock";
+		lock::ThreadSafe<Config> config;
+
+		explicit Lock(std::size_t bytes): config(bytes) { }
+
+		template<class Fn>
+		void read(Fn &&fn) { fn(*config.read()); }
+		template<class Fn>
+		void write(Fn &&fn) { fn(*config.write()); }
+	};
+
+	struct Sharded
+	{
+		static constexpr char const * name = "sharded";
+		lock::ShardedThreadSafe<Config> config;
+
+		explicit Sharded(std::size_t bytes): config(bytes) { }
+
+		template<class Fn>
+		void read(Fn &&fn) { fn(*config.read()); }
+		template<class Fn>
+		void write(Fn &&fn) { fn(*config.write()); }
+	};
+
+	struct Rcu
+	{
+		static constexpr char const * name = "rcu";
+		lock::RcuThreadSafe<Config> config;
+
+		explicit Rcu(std::size_t bytes): config(bytes) { }
+
+		template<class Fn>
+		void read(Fn &&fn) { fn(*config.read()); }
+		template<class Fn>
+		void write(Fn &&fn) { config.update(fn); }
+	};
+
+	struct LeftRight
+	{
+		static constexpr char const * name = "leftright";
+		lock::LeftRight<Config> config;
+
+		explicit LeftRight(std::size_t bytes): config(bytes) { }
+
+		template<class Fn>
+		void read(Fn &&fn) { fn(*config.read()); }
+		template<class Fn>
+		void write(Fn &&fn) { config.update(fn); }
+	};
+
+	struct SharedMutex
+	{
+		static constexpr char const * name = "shared_mutex";
+		bench::engine::SharedMutex<Config> config;
+
+		explicit SharedMutex(std::size_t bytes): config(bytes) { }
+
+		template<class Fn>
+		void read(Fn &&fn) { config.read(fn); }
+		template<class Fn>
+		void write(Fn &&fn) { config.write(fn); }
+	};
+
+	struct RwLock
+	{
+		static constexpr char const * name = "pthread_rwlock";
+		bench::engine::RwLock<Config> config;
+
+		explicit RwLock(std::size_t bytes): config(bytes) { }
+
+		template<class Fn>
+		void read(Fn &&fn) { config.read(fn); }
+		template<class Fn>
+		void write(Fn &&fn) { config.write(fn); }
+	};
+}
+
+/** The parameters of a run. */
+struct Parameters
+{
+	std::size_t size;
+	std::size_t read_words;
+	std::chrono::milliseconds interval;
+	unsigned burst;
+	std::chrono::milliseconds duration;
+};
+
+/** The results of one reader thread. */
+struct ReaderResult
+{
+	unsigned long long requests = 0;
+	/** Request latency outside of [0] and during [1] writer bursts, in nanoseconds. */
+	bench::Histogram latency[2];
+};
+
+template<class Mode>
+/** Runs one mode with one reader count. */
+void run(
+	Parameters const& parameters,
+	unsigned readers)
+{
+	Mode mode(parameters.size);
+	std::size_t const words = parameters.size / sizeof(std::uint64_t);
+	std::atomic<bool> burst(false);
+	std::vector<ReaderResult> results(readers);
+	bench::Histogram acquisitions;
+	std::uint64_t update_time = 0;
+
+	double const seconds = bench::run(readers + 1, parameters.duration, [&](unsigned t, std::atomic<bool> const& stop) {
+		bench::Random random(t + 1);
+		if(t == readers)
+		{
+			// the control thread.
+			while(!stop.load(std::memory_order_relaxed))
+			{
+				std::this_thread::sleep_for(parameters.interval);
+				burst.store(true, std::memory_order_relaxed);
+				for(unsigned i = 0; i < parameters.burst; i++)
+				{
+					std::size_t const word = random.below(words);
+					std::uint64_t const start = bench::now();
+					std::uint64_t acquired = 0;
+					mode.write([&](Config &config) {
+						// update() may call this once per replica.
+						if(!acquired)
+							acquired = bench::now();
+						config.words[word]++;
+					});
+					update_time += bench::now() - start;
+					acquisitions.record(acquired - start);
+				}
+				burst.store(false, std::memory_order_relaxed);
+			}
+			return;
+		}
+
+		ReaderResult &result = results[t];
+		std::uint64_t sum = 0;
+		while(!stop.load(std::memory_order_relaxed))
+		{
+			bool const during = burst.load(std::memory_order_relaxed);
+			std::size_t const first = random.below(words);
+			std::uint64_t const start = bench::now();
+			mode.read([&](Config const& config) {
+				for(std::size_t i = 0; i < parameters.read_words; i++)
+					sum += config.words[(first + i) % words];
+			});
+			result.latency[during].record(bench::now() - start);
+			result.requests++;
+		}
+		bench::keep(sum);
+	});
+
+	ReaderResult total;
+	for(auto const& result : results)
+	{
+		total.requests += result.requests;
+		total.latency[0].merge(result.latency[0]);
+		total.latency[1].merge(result.latency[1]);
+	}
+
+	std::printf("%-14s %5u %12.0f", Mode::name, readers, total.requests / seconds);
+	for(auto const& latency : total.latency)
+		std::printf(" %7llu %7llu %8llu",
+			(unsigned long long) latency.percentile(0.5),
+			(unsigned long long) latency.percentile(0.99),
+			(unsigned long long) latency.percentile(0.999));
+	std::printf(" %8llu %8llu %9llu %9.0f\n",
+		(unsigned long long) acquisitions.percentile(0.5),
+		(unsigned long long) acquisitions.percentile(0.99),
+		(unsigned long long) acquisitions.max(),
+		acquisitions.total() ? double(update_time) / acquisitions.total() : 0.0);
+}
+
+template<class Mode>
+/** Runs one mode with all reader counts, if it is selected. */
+void run_mode(
+	bench::Arguments const& args,
+	Parameters const& parameters,
+	std::vector<double> const& readers)
+{
+	if(args.selects("modes", Mode::name))
+		for(double count : readers)
+			run<Mode>(parameters, count);
+}
+
+int main(
+	int argc,
+	char ** argv)
+{
+	bench::Arguments const args(argc, argv);
+	std::vector<double> const readers = args.numbers("readers", {8, 64, 256});
+	Parameters const parameters {
+		std::max<std::size_t>(sizeof(std::uint64_t), args.number("size", 4096)),
+		std::size_t(args.number("read-words", 8)),
+		std::chrono::milliseconds((long) args.number("interval", 10)),
+		unsigned(args.number("burst", 10)),
+		std::chrono::milliseconds((long) args.number("ms", 1000))
+	};
+
+	std::printf("%zu byte configuration, %zu words per read, bursts of %u updates every %lld ms; latencies in ns\n",
+		parameters.size, parameters.read_words, parameters.burst, (long long) parameters.interval.count());
+	std::printf("%-14s %5s %12s %7s %7s %8s %7s %7s %8s %8s %8s %9s %9s\n",
+		"mode", "rdrs", "reads/s",
+		"p50", "p99", "p99.9",
+		"b.p50", "b.p99", "b.p99.9",
+		"w.p50", "w.p99", "w.max", "update");
+
+	run_mode<mode::Lock>(args, parameters, readers);
+	run_mode<mode::Sharded>(args, parameters, readers);
+	run_mode<mode::Rcu>(args, parameters, readers);
+	run_mode<mode::LeftRight>(args, parameters, readers);
+	run_mode<mode::SharedMutex>(args, parameters, readers);
+	run_mode<mode::RwLock>(args, parameters, readers);
+	return 0;
+}
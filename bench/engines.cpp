@@ -0,0 +1,323 @@
+/* Compares the library's locks (with the default and the queue lock engine) against std::mutex, std::shared_mutex and pthread_rwlock_t.
+
+Scenarios (select with --scenarios=single,try,multi,range):
+	single: every thread read or write locks one shared object, per the read ratio.
+	try:    the same with try_read() / try_write(), failed attempts are counted and not retried.
+	multi:  every thread locks sets of 2 to 32 objects with one multi_lock() call.
+	range:  every thread locks sets of 10 to 100k objects with one range_lock() call.
+
+For the set scenarios, every thread owns a private region of objects and all threads share one region of the same size. The overlap ratio is the fraction of each set taken from the shared region. Baseline locks acquire sets in address order.
+
+Each configuration reports the throughput of completed operations and the p50 / p99 / p99.9 latency of an operation (acquire, critical section, release), in nanoseconds. The critical section length is given in work units (see `bench::work()`).
+
+Build and run:
+	c++ -std=c++17 -O2 -pthread -Iinclude bench/engines.cpp -o engines
+	./engines [--scenarios=...] [--engines=lock,lock-queue,std::mutex,std::shared_mutex,pthread_rwlock]
+		[--threads=1,2,4,8] [--reads=0,90] [--cs=0,100] [--overlap=0,0.5,1]
+		[--multi-sizes=2,8,32] [--range-sizes=10,1000,100000] [--ms=100] */
+
+#include "Bench.hpp"
+
+#include <utility>
+
+/** The sweep parameters. */
+struct Sweep
+{
+	std::vector<double> threads;
+	std::vector<double> reads;
+	std::vector<double> cs;
+	std::vector<double> overlap;
+	std::vector<double> multi_sizes;
+	std::vector<double> range_sizes;
+	std::chrono::milliseconds duration;
+};
+
+/** The results of one configuration's worker thread. */
+struct Result
+{
+	unsigned long long operations = 0;
+	unsigned long long attempts = 0;
+	bench::Histogram latency;
+};
+
+/** Merges and prints the results of one configuration.
+@param[in] prefix:
+	The configuration's description.
+@param[in] results:
+	The results of all worker threads.
+@param[in] seconds:
+	How long the workers ran. */
+void report(
+	char const * prefix,
+	std::vector<Result> const& results,
+	double seconds)
+{
+	bench::Histogram latency;
+	unsigned long long operations = 0, attempts = 0;
+	for(auto const& result : results)
+	{
+		latency.merge(result.latency);
+		operations += result.operations;
+		attempts += result.attempts;
+	}
+
+	std::printf("%s %12.0f", prefix, operations / seconds);
+	if(attempts)
+		std::printf(" %6.1f%%", 100.0 * operations / attempts);
+	else
+		std::printf("        ");
+	std::printf(" %9llu %9llu %9llu\n",
+		(unsigned long long) latency.percentile(0.5),
+		(unsigned long long) latency.percentile(0.99),
+		(unsigned long long) latency.percentile(0.999));
+}
+
+template<class Engine>
+/** Runs the single and try scenarios for one engine. */
+void single(
+	Sweep const& sweep,
+	bool try_lock)
+{
+	for(double threads : sweep.threads)
+	for(double reads : sweep.reads)
+	for(double cs : sweep.cs)
+	{
+		Engine engine(0);
+		std::vector<Result> results((std::size_t) threads);
+
+		double const seconds = bench::run(threads, sweep.duration,
+			[&](unsigned t, std::atomic<bool> const& stop) {
+				Result &result = results[t];
+				bench::Random random(t + 1);
+				unsigned long long sum = 0;
+				while(!stop.load(std::memory_order_relaxed))
+				{
+					bool const read = random.below(100) < reads;
+					std::uint64_t const start = bench::now();
+					bool done = true;
+					if(try_lock)
+					{
+						done = read
+							? engine.try_read([&](std::uint64_t const& v) { bench::work(cs); sum += v; })
+							: engine.try_write([&](std::uint64_t &v) { bench::work(cs); ++v; });
+						result.attempts++;
+					}
+					else if(read)
+						engine.read([&](std::uint64_t const& v) { bench::work(cs); sum += v; });
+					else
+						engine.write([&](std::uint64_t &v) { bench::work(cs); ++v; });
+					result.latency.record(bench::now() - start);
+					result.operations += done;
+				}
+				bench::keep(sum);
+			});
+
+		char prefix[128];
+		std::snprintf(prefix, sizeof(prefix), "%-6s %-18s %3u %4.0f%% %5.0f %6s %5s",
+			try_lock ? "try" : "single", Engine::name, unsigned(threads), reads, cs, "1", "-");
+		report(prefix, results, seconds);
+	}
+}
+
+template<class Engine, std::size_t N>
+/** Locks a set with one call. Baselines lock it in address order.
+@tparam N:
+	The set size for multi locks, 0 for range locks. */
+struct Locker
+{
+	template<class Fn>
+	static void read(
+		std::vector<Engine *> const& set,
+		Fn &&fn)
+	{
+		Engine::read_all(set, fn);
+	}
+
+	template<class Fn>
+	static void write(
+		std::vector<Engine *> const& set,
+		Fn &&fn)
+	{
+		Engine::write_all(set, fn);
+	}
+};
+
+template<class T, class Layout, class LockEngine, std::size_t N>
+/** Locks the library's sets with `lock::multi_lock()`, or `lock::range_lock()` for range locks. */
+struct Locker<bench::engine::Library<T, Layout, LockEngine>, N>
+{
+	typedef bench::engine::Library<T, Layout, LockEngine> Engine;
+
+	template<class Fn, std::size_t ...I>
+	static void read(
+		std::vector<Engine *> const& set,
+		Fn &&fn,
+		std::index_sequence<I...>)
+	{
+		lock::ReadLock<T, Layout, LockEngine> locks[sizeof...(I)];
+		lock::multi_read_lock(lock::pair(locks[I], set[I]->resource())...);
+		for(auto &l : locks)
+			fn(*l);
+	}
+
+	template<class Fn, std::size_t ...I>
+	static void write(
+		std::vector<Engine *> const& set,
+		Fn &&fn,
+		std::index_sequence<I...>)
+	{
+		lock::WriteLock<T, Layout, LockEngine> locks[sizeof...(I)];
+		lock::multi_write_lock(lock::pair(locks[I], set[I]->resource())...);
+		for(auto &l : locks)
+			fn(*l);
+	}
+
+	template<class Fn>
+	static void read(
+		std::vector<Engine *> const& set,
+		Fn &&fn)
+	{
+		if constexpr(N != 0)
+			read(set, fn, std::make_index_sequence<N>());
+		else
+			Engine::read_all(set, fn);
+	}
+
+	template<class Fn>
+	static void write(
+		std::vector<Engine *> const& set,
+		Fn &&fn)
+	{
+		if constexpr(N != 0)
+			write(set, fn, std::make_index_sequence<N>());
+		else
+			Engine::write_all(set, fn);
+	}
+};
+
+template<class Engine, std::size_t N>
+/** Locks a set with one call (see `Locker`), and runs the critical section.
+@param[in] cs:
+	The critical section length, spent once per set. */
+void lock_set(
+	std::vector<Engine *> const& set,
+	bool read,
+	unsigned cs,
+	std::uint64_t &sum)
+{
+	bool first = true;
+	if(read)
+		Locker<Engine, N>::read(set, [&](std::uint64_t const& v) {
+			if(first)
+				bench::work(cs), first = false;
+			sum += v;
+		});
+	else
+		Locker<Engine, N>::write(set, [&](std::uint64_t &v) {
+			if(first)
+				bench::work(cs), first = false;
+			++v;
+		});
+}
+
+template<class Engine, std::size_t N>
+/** Runs the multi or range scenario with one set size for one engine.
+@tparam N:
+	The set size for multi locks, 0 for range locks.
+@param[in] size:
+	The set size. */
+void sets(
+	Sweep const& sweep,
+	std::size_t size)
+{
+	for(double threads : sweep.threads)
+	for(double reads : sweep.reads)
+	for(double cs : sweep.cs)
+	for(double overlap : sweep.overlap)
+	{
+		// region 0 is shared, region t + 1 is private to thread t.
+		std::vector<Engine> resources((unsigned(threads) + 1) * size);
+		std::size_t const shared = std::size_t(overlap * size + 0.5);
+		std::vector<Result> results((std::size_t) threads);
+
+		double const seconds = bench::run(threads, sweep.duration,
+			[&](unsigned t, std::atomic<bool> const& stop) {
+				Result &result = results[t];
+				bench::Random random(t + 1);
+				std::vector<Engine *> set(size);
+				std::uint64_t sum = 0;
+				while(!stop.load(std::memory_order_relaxed))
+				{
+					// contiguous windows at random offsets, wrapping within their region.
+					std::size_t const shared_offset = random.below(size);
+					std::size_t const private_offset = random.below(size);
+					for(std::size_t i = 0; i < shared; i++)
+						set[i] = &resources[(shared_offset + i) % size];
+					for(std::size_t i = shared; i < size; i++)
+						set[i] = &resources[(t + 1) * size + (private_offset + i) % size];
+
+					bool const read = random.below(100) < reads;
+					std::uint64_t const start = bench::now();
+					lock_set<Engine, N>(set, read, cs, sum);
+					result.latency.record(bench::now() - start);
+					result.operations++;
+				}
+				bench::keep(sum);
+			});
+
+		char prefix[128];
+		std::snprintf(prefix, sizeof(prefix), "%-6s %-18s %3u %4.0f%% %5.0f %6zu %5.2f",
+			N ? "multi" : "range", Engine::name, unsigned(threads), reads, cs, size, overlap);
+		report(prefix, results, seconds);
+	}
+}
+
+template<class Engine, std::size_t ...N>
+/** Runs the multi scenario for each requested size out of `N...`. */
+void multi(
+	Sweep const& sweep,
+	std::index_sequence<N...>)
+{
+	for(double size : sweep.multi_sizes)
+	{
+		bool found = false;
+		(void) std::initializer_list<int>{
+			(N >= 2 && size == N ? (sets<Engine, N>(sweep, N), found = true, 0) : 0)...
+		};
+		if(!found)
+			std::fprintf(stderr, "unsupported multi lock size %g, use 2 to 32.\n", size);
+	}
+}
+
+int main(
+	int argc,
+	char ** argv)
+{
+	bench::Arguments const args(argc, argv);
+	Sweep const sweep {
+		args.numbers("threads", {1, 2, 4, 8}),
+		args.numbers("reads", {0, 90}),
+		args.numbers("cs", {0, 100}),
+		args.numbers("overlap", {0, 0.5, 1}),
+		args.numbers("multi-sizes", {2, 8, 32}),
+		args.numbers("range-sizes", {10, 1000, 100000}),
+		std::chrono::milliseconds((long) args.number("ms", 100))
+	};
+
+	std::printf("%-6s %-18s %3s %5s %5s %6s %5s %12s %7s %9s %9s %9s\n",
+		"scen.", "engine", "thr", "reads", "cs", "size", "ovl.", "ops/s", "success", "p50 ns", "p99 ns", "p99.9 ns");
+
+	bench::for_all_engines<std::uint64_t>(args, [&](auto engine) {
+		typedef typename std::remove_pointer<decltype(engine)>::type Engine;
+		if(args.selects("scenarios", "single"))
+			single<Engine>(sweep, false);
+		if(args.selects("scenarios", "try"))
+			single<Engine>(sweep, true);
+		if(args.selects("scenarios", "multi"))
+			multi<Engine>(sweep, std::make_index_sequence<33>());
+		if(args.selects("scenarios", "range"))
+			for(double size : sweep.range_sizes)
+				sets<Engine, 0>(sweep, std::size_t(size));
+	});
+	return 0;
+}
@@ -0,0 +1,197 @@
+/* Measures fairness and starvation: how evenly progress is distributed over threads, and how long the unluckiest acquisition waited.
+
+Workloads (select with --workloads=read-heavy,write-heavy,multi):
+	read-heavy:  one object, --writers percent of the threads (at least one) write lock it, the rest read lock it continuously. Shows whether readers starve writers.
+	write-heavy: one object, every thread write locks it.
+	multi:       every thread locks --set-size random objects out of --objects with one call, read locking or write locking all of them with equal probability. Shows whether some threads keep losing reservation contests.
+
+Per workload, engine and role (readers / writers), it reports Jain's fairness index of the per-thread operation counts, the smallest and largest thread's share relative to an even share, how many threads completed no operation at all, and the p99.9 and maximum time a single acquisition waited. Waits are measured from the locking call until the critical section starts.
+
+Build and run:
+	c++ -std=c++17 -O2 -pthread -Iinclude bench/fairness.cpp -o fairness
+	./fairness [--workloads=...] [--engines=...] [--threads=4,16] [--writers=10]
+		[--objects=32] [--set-size=4] [--cs=50] [--think=50] [--ms=1000] */
+
+#include "Bench.hpp"
+
+/** The workloads. */
+enum Workload
+{
+	read_heavy,
+	write_heavy,
+	multi,
+	workload_count
+};
+
+char const * const workload_names[workload_count] = { "read-heavy", "write-heavy", "multi" };
+
+/** The parameters of a run. */
+struct Parameters
+{
+	double writers;
+	std::size_t objects;
+	std::size_t set_size;
+	unsigned cs;
+	unsigned think;
+	std::chrono::milliseconds duration;
+};
+
+/** The results of one thread. */
+struct Result
+{
+	bool writer = false;
+	unsigned long long operations = 0;
+	/** Acquisition waits, in nanoseconds. */
+	bench::Histogram waits;
+};
+
+/** Prints the results of the threads of one role. */
+void report(
+	Workload workload,
+	char const * engine,
+	char const * role,
+	std::vector<Result const *> const& results)
+{
+	if(results.empty())
+		return;
+
+	std::vector<unsigned long long> operations;
+	bench::Histogram waits;
+	unsigned starved = 0;
+	for(Result const * result : results)
+	{
+		operations.push_back(result->operations);
+		waits.merge(result->waits);
+		starved += !result->operations;
+	}
+
+	unsigned long long total = 0;
+	for(auto count : operations)
+		total += count;
+	auto const minmax = std::minmax_element(operations.begin(), operations.end());
+	double const even = double(total) / operations.size();
+
+	std::printf("%-11s %-18s %-7s %4zu %12llu %6.4f %6.2f %6.2f %7u %11.1f %11.1f\n",
+		workload_names[workload],
+		engine,
+		role,
+		operations.size(),
+		total,
+		bench::jain(operations),
+		even ? *minmax.first / even : 0,
+		even ? *minmax.second / even : 0,
+		starved,
+		waits.percentile(0.999) / 1000.0,
+		waits.max() / 1000.0);
+}
+
+template<class Engine>
+/** Runs one workload with one thread count. */
+void run(
+	Parameters const& parameters,
+	Workload workload,
+	unsigned threads)
+{
+	std::vector<Engine> objects(workload == multi ? parameters.objects : 1);
+	std::vector<Result> results(threads);
+
+	// the first threads are the writers.
+	unsigned const writers = workload == read_heavy
+		? std::max(1u, unsigned(threads * parameters.writers / 100 + 0.5))
+		: workload == write_heavy
+			? threads
+			: 0;
+	for(unsigned t = 0; t < writers; t++)
+		results[t].writer = true;
+
+	bench::run(threads, parameters.duration, [&](unsigned t, std::atomic<bool> const& stop) {
+		Result &result = results[t];
+		bench::Random random(t + 1);
+		std::vector<Engine *> members(parameters.set_size);
+		std::uint64_t sum = 0;
+
+		while(!stop.load(std::memory_order_relaxed))
+		{
+			std::uint64_t const start = bench::now();
+			std::uint64_t acquired = 0;
+			auto const reader = [&](std::uint64_t const& v) {
+				if(!acquired)
+				{
+					acquired = bench::now();
+					bench::work(parameters.cs);
+				}
+				sum += v;
+			};
+			auto const writer = [&](std::uint64_t &v) {
+				if(!acquired)
+				{
+					acquired = bench::now();
+					bench::work(parameters.cs);
+				}
+				++v;
+			};
+
+			if(workload == multi)
+			{
+				for(std::size_t i = 0; i < members.size(); i++)
+					for(bool unique = false; !unique;)
+					{
+						members[i] = &objects[random.below(objects.size())];
+						unique = std::find(members.begin(), members.begin() + i, members[i]) == members.begin() + i;
+					}
+				if(random.below(2))
+					Engine::read_all(members, reader);
+				else
+					Engine::write_all(members, writer);
+			}
+			else if(result.writer)
+				objects[0].write(writer);
+			else
+				objects[0].read(reader);
+
+			result.waits.record(acquired - start);
+			result.operations++;
+			bench::work(parameters.think);
+		}
+		bench::keep(sum);
+	});
+
+	std::vector<Result const *> readers, writing;
+	for(auto const& result : results)
+		(result.writer ? writing : readers).push_back(&result);
+	report(workload, Engine::name, workload == multi ? "all" : "readers", readers);
+	report(workload, Engine::name, "writers", writing);
+}
+
+int main(
+	int argc,
+	char ** argv)
+{
+	bench::Arguments const args(argc, argv);
+	std::vector<double> const threads = args.numbers("threads", {4, 16});
+	Parameters const parameters {
+		args.number("writers", 10),
+		std::size_t(args.number("objects", 32)),
+		std::size_t(args.number("set-size", 4)),
+		unsigned(args.number("cs", 50)),
+		unsigned(args.number("think", 50)),
+		std::chrono::milliseconds((long) args.number("ms", 1000))
+	};
+	if(parameters.set_size > parameters.objects)
+	{
+		std::fprintf(stderr, "--set-size must not exceed --objects.\n");
+		return 1;
+	}
+
+	std::printf("%-11s %-18s %-7s %4s %12s %6s %6s %6s %7s %11s %11s\n",
+		"workload", "engine", "role", "thr", "ops", "jain", "min", "max", "starved", "p99.9 us", "max wait us");
+
+	bench::for_all_engines<std::uint64_t>(args, [&](auto engine) {
+		typedef typename std::remove_pointer<decltype(engine)>::type Engine;
+		for(unsigned w = 0; w < workload_count; w++)
+			if(args.selects("workloads", workload_names[w]))
+				for(double t : threads)
+					run<Engine>(parameters, Workload(w), t);
+	});
+	return 0;
+}
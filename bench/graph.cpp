@@ -0,0 +1,267 @@
+/* Neighbourhood updates on a power-law graph of thread safe vertices, using range locks.
+
+The graph has --vertices vertices with power-law degrees (exponent --gamma, between --min-degree and --max-degree) and uniformly random neighbours. Its adjacency is immutable and read without locking. Every operation picks a random vertex, builds a `WriteLockPair` for it and `ReadLockPair`s for its neighbours, locks them all with one call, and sets the vertex's value to its neighbours' average.
+
+Each operation is split into three timed phases:
+	build:   allocating the locks and building the pair vectors (with --reuse=1, per-thread vectors are cleared and refilled instead).
+	acquire: the range_lock() / ordered_range_lock() call.
+	update:  the computation, and releasing the locks.
+
+Results are grouped by neighbourhood size (decades from 10 to 10,000). Retries per operation are taken from the multi lock statistics, which are keyed by lock set size, so they are only recorded when compiled with -DLOCK_STATISTICS.
+
+Build and run:
+	c++ -std=c++17 -O2 -pthread -Iinclude -DLOCK_STATISTICS bench/graph.cpp -o graph
+	./graph [--strategies=range,ordered] [--reuse=0,1] [--threads=1,4,16] [--vertices=50000]
+		[--gamma=2.1] [--min-degree=10] [--max-degree=10000] [--ms=1000] */
+
+#include "Bench.hpp"
+
+/** A vertex's data. */
+struct Vertex
+{
+	double value;
+	std::uint64_t updates;
+
+	explicit Vertex(
+		double value):
+		value(value),
+		updates(0)
+	{
+	}
+};
+
+/** A graph of thread safe vertices. */
+struct Graph
+{
+	std::vector<lock::ThreadSafe<Vertex>> vertices;
+	/** The neighbours of each vertex, sorted, without duplicates and self-loops. */
+	std::vector<std::vector<std::uint32_t>> adjacency;
+
+	/** Creates a graph with power-law degrees and random neighbours. */
+	Graph(
+		std::size_t count,
+		double gamma,
+		double min_degree,
+		double max_degree):
+		adjacency(count)
+	{
+		vertices.reserve(count);
+		for(std::size_t i = 0; i < count; i++)
+			vertices.emplace_back(double(i));
+
+		bench::Random random(count);
+		for(std::size_t v = 0; v < count; v++)
+		{
+			std::size_t const degree = std::min(max_degree,
+				min_degree * std::pow(1 - random.unit(), -1 / (gamma - 1)));
+			auto &neighbours = adjacency[v];
+			neighbours.reserve(degree);
+			while(neighbours.size() < std::min(degree, count - 1))
+			{
+				for(std::size_t i = neighbours.size(); i < degree; i++)
+					neighbours.push_back(random.below(count));
+				std::sort(neighbours.begin(), neighbours.end());
+				neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+				neighbours.erase(std::remove(neighbours.begin(), neighbours.end(), v), neighbours.end());
+			}
+		}
+	}
+};
+
+/** The neighbourhood size classes: [1, 10), [10, 100), ..., [10000, inf). */
+constexpr std::size_t classes = 5;
+
+/** Returns the class of a neighbourhood size. */
+std::size_t size_class(
+	std::size_t size)
+{
+	std::size_t c = 0;
+	for(; size >= 10 && c + 1 < classes; size /= 10)
+		c++;
+	return c;
+}
+
+/** The per-thread results of one size class. */
+struct Phases
+{
+	unsigned long long operations = 0;
+	/** Total time spent per phase, in nanoseconds. */
+	std::uint64_t build = 0, acquire = 0, update = 0;
+	/** Acquisition time, in nanoseconds. */
+	bench::Histogram acquisitions;
+
+	void merge(
+		Phases const& other)
+	{
+		operations += other.operations;
+		build += other.build;
+		acquire += other.acquire;
+		update += other.update;
+		acquisitions.merge(other.acquisitions);
+	}
+};
+
+/** A thread's lock and pair buffers. */
+struct Buffers
+{
+	lock::WriteLock<Vertex> write;
+	std::vector<lock::WriteLockPair<Vertex>> write_pair;
+	std::vector<lock::ReadLock<Vertex>> reads;
+	std::vector<lock::ReadLockPair<Vertex>> read_pairs;
+};
+
+/** Returns the total retries of the range locks per size class since the last call. Always zero without `LOCK_STATISTICS`. */
+std::vector<std::uint64_t> retries()
+{
+	static std::vector<std::uint64_t> previous(classes, 0);
+	std::vector<std::uint64_t> total(classes, 0);
+#ifdef LOCK_STATISTICS
+	for(auto const& stats : lock::multi_lock_snapshot())
+		total[size_class(stats.size - 1)] += stats.retries;
+#endif
+	std::vector<std::uint64_t> delta(classes);
+	for(std::size_t c = 0; c < classes; c++)
+		delta[c] = total[c] - previous[c];
+	previous = total;
+	return delta;
+}
+
+/** Runs one configuration. */
+void run(
+	Graph &graph,
+	bool ordered,
+	bool reuse,
+	unsigned threads,
+	std::chrono::milliseconds duration)
+{
+	std::vector<std::vector<Phases>> results(threads, std::vector<Phases>(classes));
+	retries();
+
+	double const seconds = bench::run(threads, duration, [&](unsigned t, std::atomic<bool> const& stop) {
+		bench::Random random(t + 1);
+		Buffers kept;
+		while(!stop.load(std::memory_order_relaxed))
+		{
+			std::size_t const v = random.below(graph.vertices.size());
+			auto const& neighbours = graph.adjacency[v];
+
+			std::uint64_t const start = bench::now();
+			Buffers fresh;
+			Buffers &buffers = reuse ? kept : fresh;
+			buffers.reads.resize(neighbours.size());
+			buffers.read_pairs.clear();
+			buffers.read_pairs.reserve(neighbours.size());
+			for(std::size_t i = 0; i < neighbours.size(); i++)
+				buffers.read_pairs.push_back(lock::pair(buffers.reads[i], graph.vertices[neighbours[i]]));
+			buffers.write_pair.clear();
+			buffers.write_pair.push_back(lock::pair(buffers.write, graph.vertices[v]));
+
+			std::uint64_t const built = bench::now();
+			if(ordered)
+				lock::ordered_range_lock(
+					lock::range(buffers.write_pair.begin(), buffers.write_pair.end()),
+					lock::range(buffers.read_pairs.begin(), buffers.read_pairs.end()));
+			else
+				lock::range_lock(
+					lock::range(buffers.write_pair.begin(), buffers.write_pair.end()),
+					lock::range(buffers.read_pairs.begin(), buffers.read_pairs.end()));
+
+			std::uint64_t const acquired = bench::now();
+			double sum = 0;
+			for(auto &read : buffers.reads)
+			{
+				sum += read->value;
+				read.unlock();
+			}
+			buffers.write->value = neighbours.empty() ? 0 : sum / neighbours.size();
+			buffers.write->updates++;
+			buffers.write.unlock();
+			std::uint64_t const updated = bench::now();
+
+			Phases &phases = results[t][size_class(neighbours.size())];
+			phases.operations++;
+			phases.build += built - start;
+			phases.acquire += acquired - built;
+			phases.update += updated - acquired;
+			phases.acquisitions.record(acquired - built);
+		}
+	});
+
+	std::vector<std::uint64_t> const retried = retries();
+	unsigned long long total = 0;
+	for(std::size_t c = 0; c < classes; c++)
+	{
+		Phases phases;
+		for(auto const& result : results)
+			phases.merge(result[c]);
+		total += phases.operations;
+		if(!phases.operations)
+			continue;
+
+		double const ops = phases.operations;
+		char neighbourhood[32];
+		std::snprintf(neighbourhood, sizeof(neighbourhood), "%.0f..%.0f",
+			std::pow(10.0, c), std::pow(10.0, c + 1) - 1);
+		std::printf("%-7s %5s %3u %12s %10llu %10.2f %10.2f %10.2f %10.2f",
+			ordered ? "ordered" : "range",
+			reuse ? "yes" : "no",
+			threads,
+			c + 1 == classes ? "10000+" : neighbourhood,
+			phases.operations,
+			phases.build / ops / 1000,
+			phases.acquire / ops / 1000,
+			phases.acquisitions.percentile(0.99) / 1000.0,
+			phases.update / ops / 1000);
+		if(ordered)
+			std::printf(" %9s\n", "-");
+		else
+			std::printf(" %9.3f\n", retried[c] / ops);
+	}
+	std::printf("%-7s %5s %3u %12s %10.0f operations/s\n",
+		ordered ? "ordered" : "range",
+		reuse ? "yes" : "no",
+		threads,
+		"all",
+		total / seconds);
+}
+
+int main(
+	int argc,
+	char ** argv)
+{
+	bench::Arguments const args(argc, argv);
+	std::vector<double> const threads = args.numbers("threads", {1, 4, 16});
+	std::vector<double> const reuses = args.numbers("reuse", {0, 1});
+	std::chrono::milliseconds const duration((long) args.number("ms", 1000));
+
+	std::uint64_t const start = bench::now();
+	Graph graph(
+		args.number("vertices", 50000),
+		args.number("gamma", 2.1),
+		args.number("min-degree", 10),
+		args.number("max-degree", 10000));
+
+	std::size_t edges = 0, largest = 0;
+	for(auto const& neighbours : graph.adjacency)
+	{
+		edges += neighbours.size();
+		largest = std::max(largest, neighbours.size());
+	}
+	std::printf("%zu vertices, %zu edges, largest neighbourhood %zu, generated in %.1f s\n",
+		graph.vertices.size(), edges, largest, (bench::now() - start) * 1e-9);
+#ifndef LOCK_STATISTICS
+	std::printf("compiled without LOCK_STATISTICS: retries are not recorded.\n");
+#endif
+	std::printf("%-7s %5s %3s %12s %10s %10s %10s %10s %10s %9s\n",
+		"lock", "reuse", "thr", "neighbours", "ops", "build us", "acquire us", "p99 acq.", "update us", "retry/op");
+
+	for(char const * strategy : { "range", "ordered" })
+	{
+		if(!args.selects("strategies", strategy))
+			continue;
+		for(double reuse : reuses)
+			for(double t : threads)
+				run(graph, strategy[0] == 'o', reuse != 0, t, duration);
+	}
+	return 0;
+}
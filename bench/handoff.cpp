@@ -0,0 +1,101 @@
+/* Measures lock handoff latency as the number of waiting threads grows.
+
+Every thread repeatedly write locks one shared object, does --cs work units in the critical section and --think work units outside of it. The holder stores a timestamp just before it releases the lock; the next holder measures the time from there until its critical section starts. Only handoffs between different threads are measured: the share of acquisitions where the releasing thread locked again right away (overtaking the waiters) is reported separately.
+
+With a short think time, all other threads are waiting on the lock at any time, so the thread count is the waiter count plus one. An engine whose waiters all retry on the shared lock word shows handoff latency growing with the waiter count; a queue lock keeps it constant.
+
+Build and run:
+	c++ -std=c++17 -O2 -pthread -Iinclude bench/handoff.cpp -o handoff
+	./handoff [--engines=lock,lock-queue,std::mutex,...] [--threads=2,4,8,16,32,64,128]
+		[--cs=20] [--think=0] [--ms=500] */
+
+#include "Bench.hpp"
+
+/** The shared object: who released it last, and when. */
+struct Baton
+{
+	std::uint64_t released = 0;
+	unsigned holder = ~0u;
+};
+
+/** The results of one thread. */
+struct Result
+{
+	unsigned long long acquisitions = 0;
+	/** Acquisitions directly after the thread's own release. */
+	unsigned long long reacquisitions = 0;
+	/** Handoff latency from another thread, in nanoseconds. */
+	bench::Histogram handoffs;
+};
+
+template<class Engine>
+/** Runs one engine with one thread count. */
+void run(
+	unsigned threads,
+	unsigned cs,
+	unsigned think,
+	std::chrono::milliseconds duration)
+{
+	Engine baton;
+	std::vector<Result> results(threads);
+
+	double const seconds = bench::run(threads, duration, [&](unsigned t, std::atomic<bool> const& stop) {
+		Result &result = results[t];
+		while(!stop.load(std::memory_order_relaxed))
+		{
+			baton.write([&](Baton &b) {
+				std::uint64_t const acquired = bench::now();
+				if(b.holder == t)
+					result.reacquisitions++;
+				else if(b.released)
+					result.handoffs.record(acquired - b.released);
+				result.acquisitions++;
+
+				bench::work(cs);
+				b.holder = t;
+				b.released = bench::now();
+			});
+			bench::work(think);
+		}
+	});
+
+	Result total;
+	for(auto const& result : results)
+	{
+		total.acquisitions += result.acquisitions;
+		total.reacquisitions += result.reacquisitions;
+		total.handoffs.merge(result.handoffs);
+	}
+
+	std::printf("%-18s %4u %12.0f %7.2f %9llu %9llu %9llu %10llu\n",
+		Engine::name,
+		threads,
+		total.acquisitions / seconds,
+		total.acquisitions ? 100.0 * total.reacquisitions / total.acquisitions : 0.0,
+		(unsigned long long) total.handoffs.percentile(0.5),
+		(unsigned long long) total.handoffs.percentile(0.99),
+		(unsigned long long) total.handoffs.percentile(0.999),
+		(unsigned long long) total.handoffs.max());
+}
+
+int main(
+	int argc,
+	char ** argv)
+{
+	bench::Arguments const args(argc, argv);
+	std::vector<double> const threads = args.numbers("threads", {2, 4, 8, 16, 32, 64, 128});
+	unsigned const cs = args.number("cs", 20);
+	unsigned const think = args.number("think", 0);
+	std::chrono::milliseconds const duration((long) args.number("ms", 500));
+
+	std::printf("%u work units inside and %u outside of the lock; latencies in ns\n", cs, think);
+	std::printf("%-18s %4s %12s %7s %9s %9s %9s %10s\n",
+		"engine", "thr", "acq/s", "same %", "p50", "p99", "p99.9", "max");
+
+	bench::for_all_engines<Baton>(args, [&](auto engine) {
+		typedef typename std::remove_pointer<decltype(engine)>::type Engine;
+		for(double t : threads)
+			run<Engine>(t, cs, think, duration);
+	});
+	return 0;
+}
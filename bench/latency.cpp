@@ -0,0 +1,209 @@
+/* Measures the tail latency of lock acquisitions under open-loop load.
+
+Every thread issues operations on a fixed schedule (--rate per thread), independent of how long earlier operations took. The latency of an operation is measured from its scheduled start, not from when the thread got around to starting it, so a stall delays and is charged to every operation scheduled during it (corrected for coordinated omission). The uncorrected time from the actual start is reported as well.
+
+Operations (per thread, chosen at random per the mix):
+	read:  read() on one of --objects objects.
+	write: write() on one of --objects objects.
+	multi: multi_lock() write locking --set-size (2, 4 or 8) distinct objects.
+
+Timestamps come from the CPU's time stamp counter (see `bench::ticks()`). For each operation, the acquisition latency is printed as an HdrHistogram-style percentile table in microseconds. With --output=prefix, the corrected histograms are also written to prefix.read.hist etc.; histogram files of several runs or machines are merged and printed with --merge=file,file,...
+
+Build and run:
+	c++ -std=c++17 -O2 -pthread -Iinclude bench/latency.cpp -o latency
+	./latency [--threads=N] [--rate=100000] [--ms=2000] [--reads=80] [--multi=5]
+		[--objects=16] [--set-size=2] [--cs=10] [--output=prefix]
+	./latency --merge=a.write.hist,b.write.hist */
+
+#include "Bench.hpp"
+
+/** The operation kinds. */
+enum Operation
+{
+	op_read,
+	op_write,
+	op_multi,
+	operation_count
+};
+
+char const * const operation_names[operation_count] = { "read", "write", "multi" };
+
+/** The results of one worker thread. */
+struct Result
+{
+	/** Acquisition latency from the scheduled start, in nanoseconds. */
+	bench::Histogram corrected[operation_count];
+	/** Acquisition latency from the actual start, in nanoseconds. */
+	bench::Histogram uncorrected[operation_count];
+	/** How many operations started late. */
+	unsigned long long late = 0;
+};
+
+template<std::size_t ...I>
+/** Write locks the objects at the given indices with one `lock::multi_write_lock()` call.
+@param[out] acquired:
+	When all objects were locked, in ticks. */
+void lock_set(
+	std::vector<lock::ThreadSafe<std::uint64_t>> &objects,
+	std::size_t const * indices,
+	unsigned cs,
+	std::uint64_t &acquired,
+	std::index_sequence<I...>)
+{
+	lock::WriteLock<std::uint64_t> locks[sizeof...(I)];
+	lock::multi_write_lock(lock::pair(locks[I], objects[indices[I]])...);
+	acquired = bench::ticks();
+	bench::work(cs);
+	for(auto &l : locks)
+		++*l;
+}
+
+int main(
+	int argc,
+	char ** argv)
+{
+	bench::Arguments const args(argc, argv);
+
+	if(args.has("merge"))
+	{
+		bench::Histogram merged;
+		std::string const files = args.text("merge", "") + ",";
+		for(std::size_t begin = 0, end; (end = files.find(',', begin)) != std::string::npos; begin = end + 1)
+		{
+			std::string const file = files.substr(begin, end - begin);
+			if(!file.empty() && !merged.load(file.c_str()))
+			{
+				std::fprintf(stderr, "could not read histogram file '%s'.\n", file.c_str());
+				return 1;
+			}
+		}
+		merged.print(stdout, 1000);
+		return 0;
+	}
+
+	unsigned const threads = args.number("threads", std::max(1u, std::thread::hardware_concurrency()));
+	double const rate = args.number("rate", 100000);
+	std::chrono::milliseconds const duration((long) args.number("ms", 2000));
+	double const reads = args.number("reads", 80);
+	double const multis = args.number("multi", 5);
+	std::size_t const objects = args.number("objects", 16);
+	std::size_t const set_size = args.number("set-size", 2);
+	unsigned const cs = args.number("cs", 10);
+
+	if(set_size != 2 && set_size != 4 && set_size != 8)
+	{
+		std::fprintf(stderr, "--set-size must be 2, 4 or 8.\n");
+		return 1;
+	}
+	if(objects < set_size)
+	{
+		std::fprintf(stderr, "--objects must be at least --set-size.\n");
+		return 1;
+	}
+
+	double const ticks_per_ns = bench::ticks_per_ns();
+	std::uint64_t const interval = ticks_per_ns * 1e9 / rate;
+	std::vector<lock::ThreadSafe<std::uint64_t>> resources(objects);
+	std::vector<Result> results(threads);
+
+	std::printf("%u threads, %.0f operations/s per thread, %.2f ticks/ns\n", threads, rate, ticks_per_ns);
+
+	bench::run(threads, duration, [&](unsigned t, std::atomic<bool> const& stop) {
+		Result &result = results[t];
+		bench::Random random(t + 1);
+		// stagger the threads' schedules.
+		std::uint64_t next = bench::ticks() + interval * t / threads;
+
+		while(!stop.load(std::memory_order_relaxed))
+		{
+			// wait for the scheduled start, sleeping if it is far away.
+			for(std::uint64_t current; (current = bench::ticks()) < next;)
+				if(next - current > 100000 * ticks_per_ns)
+					std::this_thread::sleep_for(std::chrono::microseconds(50));
+
+			std::uint64_t const scheduled = next;
+			next += interval;
+
+			double const choice = random.unit() * 100;
+			Operation const operation = choice < reads
+				? op_read
+				: choice < reads + multis
+					? op_multi
+					: op_write;
+
+			std::uint64_t const start = bench::ticks();
+			std::uint64_t acquired;
+			switch(operation)
+			{
+			case op_read:
+				{
+					lock::ReadLock<std::uint64_t> l = resources[random.below(objects)].read();
+					acquired = bench::ticks();
+					bench::work(cs);
+					bench::keep(*l);
+				} break;
+			case op_write:
+				{
+					lock::WriteLock<std::uint64_t> l = resources[random.below(objects)].write();
+					acquired = bench::ticks();
+					bench::work(cs);
+					++*l;
+				} break;
+			default:
+				{
+					std::size_t indices[8];
+					for(std::size_t i = 0; i < set_size; i++)
+						for(bool unique = false; !unique;)
+						{
+							indices[i] = random.below(objects);
+							unique = std::find(indices, indices + i, indices[i]) == indices + i;
+						}
+					switch(set_size)
+					{
+					case 2: lock_set(resources, indices, cs, acquired, std::make_index_sequence<2>()); break;
+					case 4: lock_set(resources, indices, cs, acquired, std::make_index_sequence<4>()); break;
+					default: lock_set(resources, indices, cs, acquired, std::make_index_sequence<8>()); break;
+					}
+				} break;
+			}
+
+			result.corrected[operation].record((acquired - scheduled) / ticks_per_ns);
+			result.uncorrected[operation].record((acquired - start) / ticks_per_ns);
+			result.late += start - scheduled > interval;
+		}
+	});
+
+	unsigned long long late = 0;
+	for(auto const& result : results)
+		late += result.late;
+	std::printf("%llu operations started more than one interval late.\n", late);
+
+	for(unsigned op = 0; op < operation_count; op++)
+	{
+		bench::Histogram corrected, uncorrected;
+		for(auto const& result : results)
+		{
+			corrected.merge(result.corrected[op]);
+			uncorrected.merge(result.uncorrected[op]);
+		}
+		if(!corrected.total())
+			continue;
+
+		std::printf("\n%s: acquisition latency (us), corrected for coordinated omission\n", operation_names[op]);
+		corrected.print(stdout, 1000);
+		std::printf("%s: uncorrected p50 %.3f us, p99 %.3f us, p99.9 %.3f us, max %.3f us\n",
+			operation_names[op],
+			uncorrected.percentile(0.5) / 1000.0,
+			uncorrected.percentile(0.99) / 1000.0,
+			uncorrected.percentile(0.999) / 1000.0,
+			uncorrected.max() / 1000.0);
+
+		if(args.has("output"))
+		{
+			std::string const path = args.text("output", "") + "." + operation_names[op] + ".hist";
+			if(!corrected.save(path.c_str()))
+				std::fprintf(stderr, "could not write histogram file '%s'.\n", path.c_str());
+		}
+	}
+	return 0;
+}
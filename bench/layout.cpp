@@ -0,0 +1,93 @@
+/* Measures the effect of the `ThreadSafe` layout policies on `range_lock()` over a vector.
+
+Every thread repeatedly write locks its own window of neighbouring elements, so the threads never contend for the same lock. Any slowdown of the compact layout compared to the padded and separated layouts is caused by false sharing between neighbouring windows.
+
+Build and run:
+	c++ -std=c++17 -O2 -pthread -Iinclude bench/layout.cpp -o layout
+	./layout [threads] [window] [milliseconds] */
+
+#include <Lock/Lock.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+template<class Layout>
+/** Runs the benchmark for one layout.
+@param[in] name:
+	The name of the layout, for the output.
+@param[in] threads:
+	How many threads to run.
+@param[in] window:
+	How many neighbouring elements each thread locks at once.
+@param[in] duration:
+	How long to run. */
+void run(
+	char const * name,
+	unsigned threads,
+	std::size_t window,
+	std::chrono::milliseconds duration)
+{
+	std::vector<lock::ThreadSafe<int, Layout>> resources(threads * window);
+	std::atomic<bool> stop(false);
+	std::vector<unsigned long long> operations(threads, 0);
+	std::vector<std::thread> workers;
+
+	for(unsigned t = 0; t < threads; t++)
+		workers.emplace_back([&, t]{
+			std::vector<lock::WriteLock<int, Layout>> locks(window);
+			std::vector<lock::WriteLockPair<int, Layout>> pairs;
+			for(std::size_t i = 0; i < window; i++)
+				pairs.push_back(lock::pair(locks[i], resources[t * window + i]));
+
+			unsigned long long count = 0;
+			while(!stop.load(std::memory_order_relaxed))
+			{
+				lock::range_lock(lock::range(pairs.begin(), pairs.end()));
+				for(auto &l : locks)
+				{
+					++*l;
+					l.unlock();
+				}
+				count++;
+			}
+			operations[t] = count;
+		});
+
+	std::this_thread::sleep_for(duration);
+	stop.store(true);
+	for(auto &worker : workers)
+		worker.join();
+
+	unsigned long long total = 0;
+	for(auto count : operations)
+		total += count;
+
+	std::printf("%-10s %6zu B/element %12.0f range locks/s\n",
+		name,
+		sizeof(lock::ThreadSafe<int, Layout>),
+		total * 1000.0 / duration.count());
+}
+
+int main(
+	int argc,
+	char ** argv)
+{
+	unsigned const threads = argc > 1
+		? std::strtoul(argv[1], nullptr, 10)
+		: std::max(2u, std::thread::hardware_concurrency());
+	std::size_t const window = argc > 2
+		? std::strtoul(argv[2], nullptr, 10)
+		: 4;
+	std::chrono::milliseconds const duration(argc > 3
+		? std::strtoul(argv[3], nullptr, 10)
+		: 1000);
+
+	std::printf("%u threads, %zu elements per thread\n", threads, window);
+	run<lock::layout::Compact>("compact", threads, window, duration);
+	run<lock::layout::Padded>("padded", threads, window, duration);
+	run<lock::layout::Separated>("separated", threads, window, duration);
+	return 0;
+}
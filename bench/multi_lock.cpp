@@ -0,0 +1,289 @@
+/* Deadlock-prone workloads for multi locks: bank transfers and dining philosophers.
+
+Workloads (select with --workloads=bank,philosophers):
+	bank:         every thread transfers money between two accounts drawn from a Zipfian distribution over --accounts accounts (--skew 0 is uniform, around 1 a few accounts are very hot). The total balance is checked afterwards.
+	philosophers: a ring of forks, philosopher i locks forks i and i + 1. With --philosophers=0 (the default), every thread is its own philosopher; otherwise threads pick philosophers from a Zipfian distribution.
+
+Strategies (select with --strategies=multi,ordered,mutex):
+	multi:   lock::multi_write_lock() (reservations, retries).
+	ordered: lock::ordered_multi_lock() (address order, no retries).
+	mutex:   std::lock() on two std::mutex (try and back off).
+
+Reports throughput, multi_lock() retries and lost reservations per operation, and the fairness of the threads' progress: Jain's index of the per-thread operation counts, and the smallest / largest thread's share relative to an even share. Retries are only recorded when compiled with -DLOCK_STATISTICS, which adds some overhead to every lock.
+
+Build and run:
+	c++ -std=c++17 -O2 -pthread -Iinclude -DLOCK_STATISTICS bench/multi_lock.cpp -o multi_lock
+	./multi_lock [--workloads=...] [--strategies=...] [--threads=2,8,32] [--skew=0,0.99]
+		[--accounts=10000] [--philosophers=0] [--cs=10] [--ms=500] */
+
+#include "Bench.hpp"
+
+/** A bank account. */
+struct Account
+{
+	std::int64_t balance = 1000;
+	std::uint64_t transfers = 0;
+};
+
+/** The strategies for locking two resources. */
+enum Strategy
+{
+	strategy_multi,
+	strategy_ordered,
+	strategy_mutex,
+	strategy_count
+};
+
+char const * const strategy_names[strategy_count] = { "multi", "ordered", "mutex" };
+
+/** The call site names of the workloads' `multi_lock()` calls. */
+char const bank_site[] = "bank", philosophers_site[] = "philosophers";
+
+/** The multi lock statistics of a call site. */
+struct Retries
+{
+	std::uint64_t calls = 0;
+	std::uint64_t retries = 0;
+	std::uint64_t losses = 0;
+
+	/** Returns the statistics recorded so far. */
+	static Retries of(
+		char const * site)
+	{
+		Retries sum;
+#ifdef LOCK_STATISTICS
+		for(auto const& stats : lock::multi_lock_snapshot())
+			if(stats.site == site)
+			{
+				sum.calls += stats.calls;
+				sum.retries += stats.retries;
+				sum.losses += stats.reservation_losses;
+			}
+#else
+		(void) site;
+#endif
+		return sum;
+	}
+};
+
+template<class T>
+/** Two resources for each strategy, locked as a pair. */
+struct Resources
+{
+	std::vector<lock::ThreadSafe<T>> library;
+	std::vector<bench::engine::Mutex<T>> mutexes;
+
+	Resources(
+		Strategy strategy,
+		std::size_t count):
+		library(strategy == strategy_mutex ? 0 : count),
+		mutexes(strategy == strategy_mutex ? count : 0)
+	{
+	}
+
+	/** Locks resources `a` and `b` with the given strategy, and calls `fn(a, b)`. */
+	template<class Fn>
+	void lock(
+		Strategy strategy,
+		std::size_t a,
+		std::size_t b,
+		Fn &&fn)
+	{
+		if(strategy == strategy_mutex)
+		{
+			std::lock(mutexes[a].mutex, mutexes[b].mutex);
+			fn(mutexes[a].value, mutexes[b].value);
+			mutexes[a].mutex.unlock();
+			mutexes[b].mutex.unlock();
+			return;
+		}
+
+		lock::WriteLock<T> lock_a, lock_b;
+		if(strategy == strategy_multi)
+			lock::multi_write_lock(
+				lock::pair(lock_a, library[a]),
+				lock::pair(lock_b, library[b]));
+		else
+			lock::ordered_multi_lock(
+				lock::pair(lock_a, library[a]),
+				lock::pair(lock_b, library[b]));
+		fn(*lock_a, *lock_b);
+	}
+
+	/** Calls `fn` with every resource. The resources must not be locked. */
+	template<class Fn>
+	void each(
+		Fn &&fn)
+	{
+		for(auto &resource : library)
+			fn(*resource.read());
+		for(auto &resource : mutexes)
+			fn(resource.value);
+	}
+};
+
+/** Prints the results of one configuration.
+@param[in] operations:
+	The completed operations of each thread.
+@param[in] before, after:
+	The call site's multi lock statistics before and after the run. */
+void report(
+	char const * workload,
+	Strategy strategy,
+	double skew,
+	std::vector<unsigned long long> const& operations,
+	double seconds,
+	Retries const& before,
+	Retries const& after)
+{
+	unsigned long long total = 0;
+	for(auto count : operations)
+		total += count;
+	auto const minmax = std::minmax_element(operations.begin(), operations.end());
+	double const even = double(total) / operations.size();
+
+	std::printf("%-12s %-8s %4zu %5.2f %12.0f",
+		workload, strategy_names[strategy], operations.size(), skew, total / seconds);
+
+	std::uint64_t const calls = after.calls - before.calls;
+	if(strategy == strategy_multi && calls)
+		std::printf(" %9.3f %9.3f",
+			double(after.retries - before.retries) / calls,
+			double(after.losses - before.losses) / calls);
+	else
+		std::printf(" %9s %9s", "-", "-");
+
+	std::printf(" %6.4f %6.2f %6.2f\n",
+		bench::jain(operations),
+		even ? *minmax.first / even : 0,
+		even ? *minmax.second / even : 0);
+}
+
+/** Runs the bank workload with one configuration. */
+void bank(
+	Strategy strategy,
+	unsigned threads,
+	double skew,
+	std::size_t accounts,
+	unsigned cs,
+	std::chrono::milliseconds duration)
+{
+	Resources<Account> resources(strategy, accounts);
+	bench::Zipf const zipf(accounts, skew);
+	std::vector<unsigned long long> operations(threads, 0);
+	Retries const before = Retries::of(bank_site);
+
+	double const seconds = bench::run(threads, duration, [&](unsigned t, std::atomic<bool> const& stop) {
+		lock::CallSite site(bank_site);
+		bench::Random random(t + 1);
+		unsigned long long count = 0;
+		while(!stop.load(std::memory_order_relaxed))
+		{
+			std::size_t const from = zipf(random);
+			std::size_t to;
+			do to = zipf(random); while(to == from);
+			std::int64_t const amount = random.below(100);
+
+			resources.lock(strategy, from, to, [&](Account &a, Account &b) {
+				bench::work(cs);
+				if(a.balance >= amount)
+				{
+					a.balance -= amount;
+					b.balance += amount;
+				}
+				a.transfers++;
+				b.transfers++;
+			});
+			count++;
+		}
+		operations[t] = count;
+	});
+
+	std::int64_t balance = 0;
+	resources.each([&](Account const& account) { balance += account.balance; });
+	if(balance != std::int64_t(accounts) * Account().balance)
+		std::printf("ERROR: total balance changed to %lld.\n", (long long) balance);
+
+	report("bank", strategy, skew, operations, seconds, before, Retries::of(bank_site));
+}
+
+/** Runs the dining philosophers workload with one configuration. */
+void philosophers(
+	Strategy strategy,
+	unsigned threads,
+	double skew,
+	std::size_t philosophers,
+	unsigned cs,
+	std::chrono::milliseconds duration)
+{
+	bool const own = !philosophers;
+	if(own)
+		philosophers = std::max(2u, threads);
+	// forks count their uses.
+	Resources<std::uint64_t> forks(strategy, philosophers);
+	bench::Zipf const zipf(philosophers, skew);
+	std::vector<unsigned long long> operations(threads, 0);
+	Retries const before = Retries::of(philosophers_site);
+
+	double const seconds = bench::run(threads, duration, [&](unsigned t, std::atomic<bool> const& stop) {
+		lock::CallSite site(philosophers_site);
+		bench::Random random(t + 1);
+		unsigned long long count = 0;
+		while(!stop.load(std::memory_order_relaxed))
+		{
+			std::size_t const philosopher = own ? t : zipf(random);
+			forks.lock(strategy, philosopher, (philosopher + 1) % philosophers,
+				[&](std::uint64_t &left, std::uint64_t &right) {
+					bench::work(cs);
+					left++;
+					right++;
+				});
+			count++;
+		}
+		operations[t] = count;
+	});
+
+	report("philosophers", strategy, own ? 0 : skew, operations, seconds, before, Retries::of(philosophers_site));
+}
+
+int main(
+	int argc,
+	char ** argv)
+{
+	bench::Arguments const args(argc, argv);
+	std::vector<double> const threads = args.numbers("threads", {2, 8, 32});
+	std::vector<double> const skews = args.numbers("skew", {0, 0.99});
+	std::size_t const accounts = args.number("accounts", 10000);
+	std::size_t const philosopher_count = args.number("philosophers", 0);
+	unsigned const cs = args.number("cs", 10);
+	std::chrono::milliseconds const duration((long) args.number("ms", 500));
+
+#ifndef LOCK_STATISTICS
+	std::printf("compiled without LOCK_STATISTICS: retries are not recorded.\n");
+#endif
+	std::printf("%-12s %-8s %4s %5s %12s %9s %9s %6s %6s %6s\n",
+		"workload", "strategy", "thr", "skew", "ops/s", "retry/op", "lost/op", "jain", "min", "max");
+
+	for(unsigned s = 0; s < strategy_count; s++)
+	{
+		Strategy const strategy = Strategy(s);
+		if(!args.selects("strategies", strategy_names[s]))
+			continue;
+
+		for(double t : threads)
+		{
+			if(args.selects("workloads", "bank"))
+				for(double skew : skews)
+					bank(strategy, t, skew, accounts, cs, duration);
+			if(args.selects("workloads", "philosophers"))
+			{
+				if(philosopher_count)
+					for(double skew : skews)
+						philosophers(strategy, t, skew, philosopher_count, cs, duration);
+				else
+					philosophers(strategy, t, 0, 0, cs, duration);
+			}
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,219 @@
+/* Measures how much CPU time waiting threads burn when threads outnumber cores.
+
+Runs --factors times as many threads as there are cores (1x to 8x by default), each repeatedly locking and doing --cs work units in the critical section and --think work units outside of it. For each configuration, the process's CPU time and context switches are read with getrusage() and reported per completed acquisition, together with the useful throughput and the CPU utilisation (CPU time / wall time / cores). An engine that burns CPU while waiting shows a high CPU time per acquisition and a utilisation near 1 even though only one thread can make progress.
+
+Workloads (select with --workloads=single,set):
+	single: one object, read or write locked per the read ratio.
+	set:    --set-size random objects out of --objects, locked with one range_lock() call (baselines lock them in address order).
+
+Engines: lock::ThreadSafe (with the default and the queue lock engine), std::mutex, std::shared_mutex, pthread_rwlock_t, and `yield`, a test-and-set lock that yields while waiting (the library's behaviour before it parked waiters).
+
+Build and run:
+	c++ -std=c++17 -O2 -pthread -Iinclude bench/oversubscription.cpp -o oversubscription
+	./oversubscription [--workloads=...] [--engines=...] [--factors=1,2,4,8] [--cores=N]
+		[--reads=0] [--cs=100] [--think=100] [--objects=64] [--set-size=4] [--ms=500] */
+
+#include "Bench.hpp"
+
+#include <sys/resource.h>
+
+template<class T>
+/** Test-and-set lock that yields while waiting. Readers are exclusive too, sets are locked in address order. */
+struct Yield
+{
+	static constexpr char const * name = "yield";
+	std::atomic<bool> locked;
+	T value;
+
+	template<class ...Args>
+	explicit Yield(
+		Args&&... args):
+		locked(false),
+		value(std::forward<Args>(args)...)
+	{
+	}
+
+	void lock()
+	{
+		while(locked.exchange(true, std::memory_order_acquire))
+			std::this_thread::yield();
+	}
+	void unlock()
+	{
+		locked.store(false, std::memory_order_release);
+	}
+
+	template<class Fn>
+	void read(Fn &&fn) { write(fn); }
+	template<class Fn>
+	void write(Fn &&fn)
+	{
+		lock();
+		fn(value);
+		unlock();
+	}
+
+	template<class Fn>
+	static void read_all(
+		std::vector<Yield *> const& set,
+		Fn &&fn) { write_all(set, fn); }
+	template<class Fn>
+	static void write_all(
+		std::vector<Yield *> const& set,
+		Fn &&fn)
+	{
+		bench::engine::ordered(set,
+			[](Yield &l) { l.lock(); },
+			[](Yield &l) { l.unlock(); },
+			fn);
+	}
+};
+
+/** Process resource usage. */
+struct Usage
+{
+	/** User and system CPU time, in seconds. */
+	double cpu;
+	/** Voluntary and involuntary context switches. */
+	long voluntary, involuntary;
+
+	/** Returns the resource usage of the process so far, including all of its threads. */
+	static Usage now()
+	{
+		rusage usage;
+		getrusage(RUSAGE_SELF, &usage);
+		return Usage {
+			usage.ru_utime.tv_sec + usage.ru_stime.tv_sec
+				+ (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e-6,
+			usage.ru_nvcsw,
+			usage.ru_nivcsw
+		};
+	}
+};
+
+/** The parameters of a run. */
+struct Parameters
+{
+	unsigned cores;
+	double reads;
+	unsigned cs;
+	unsigned think;
+	std::size_t objects;
+	std::size_t set_size;
+	std::chrono::milliseconds duration;
+};
+
+template<class Engine>
+/** Runs one workload with one thread count. */
+void run(
+	Parameters const& parameters,
+	bool set,
+	double factor)
+{
+	unsigned const threads = std::max(1u, unsigned(parameters.cores * factor + 0.5));
+	std::vector<Engine> objects(set ? parameters.objects : 1);
+	std::vector<unsigned long long> operations(threads, 0);
+
+	Usage const before = Usage::now();
+	double const seconds = bench::run(threads, parameters.duration, [&](unsigned t, std::atomic<bool> const& stop) {
+		bench::Random random(t + 1);
+		std::vector<Engine *> members(parameters.set_size);
+		unsigned long long count = 0;
+		std::uint64_t sum = 0;
+		auto const reader = [&](std::uint64_t const& v) { sum += v; };
+		auto const writer = [&](std::uint64_t &v) { ++v; };
+
+		while(!stop.load(std::memory_order_relaxed))
+		{
+			bool const read = random.unit() * 100 < parameters.reads;
+			if(set)
+			{
+				for(std::size_t i = 0; i < members.size(); i++)
+					for(bool unique = false; !unique;)
+					{
+						members[i] = &objects[random.below(objects.size())];
+						unique = std::find(members.begin(), members.begin() + i, members[i]) == members.begin() + i;
+					}
+				bool first = true;
+				auto const work = [&] {
+					if(first)
+						bench::work(parameters.cs), first = false;
+				};
+				if(read)
+					Engine::read_all(members, [&](std::uint64_t const& v) { work(); reader(v); });
+				else
+					Engine::write_all(members, [&](std::uint64_t &v) { work(); writer(v); });
+			}
+			else if(read)
+				objects[0].read([&](std::uint64_t const& v) { bench::work(parameters.cs); reader(v); });
+			else
+				objects[0].write([&](std::uint64_t &v) { bench::work(parameters.cs); writer(v); });
+
+			bench::work(parameters.think);
+			count++;
+		}
+		operations[t] = count;
+		bench::keep(sum);
+	});
+	Usage const after = Usage::now();
+
+	unsigned long long total = 0;
+	for(auto count : operations)
+		total += count;
+	double const cpu = after.cpu - before.cpu;
+	double const per = total ? 1.0 / total : 0;
+
+	std::printf("%-6s %-18s %4.1fx %4u %12.0f %8.2f %10.3f %9.4f %9.4f %6.2f\n",
+		set ? "set" : "single",
+		Engine::name,
+		factor,
+		threads,
+		total / seconds,
+		cpu,
+		cpu * 1e6 * per,
+		(after.voluntary - before.voluntary) * per,
+		(after.involuntary - before.involuntary) * per,
+		cpu / seconds / parameters.cores);
+}
+
+int main(
+	int argc,
+	char ** argv)
+{
+	bench::Arguments const args(argc, argv);
+	std::vector<double> const factors = args.numbers("factors", {1, 2, 4, 8});
+	Parameters const parameters {
+		unsigned(args.number("cores", std::max(1u, std::thread::hardware_concurrency()))),
+		args.number("reads", 0),
+		unsigned(args.number("cs", 100)),
+		unsigned(args.number("think", 100)),
+		std::size_t(args.number("objects", 64)),
+		std::size_t(args.number("set-size", 4)),
+		std::chrono::milliseconds((long) args.number("ms", 500))
+	};
+	if(parameters.set_size > parameters.objects)
+	{
+		std::fprintf(stderr, "--set-size must not exceed --objects.\n");
+		return 1;
+	}
+
+	std::printf("%u cores, %.0f%% reads, %u work units inside and %u outside of the lock\n",
+		parameters.cores, parameters.reads, parameters.cs, parameters.think);
+	std::printf("%-6s %-18s %5s %4s %12s %8s %10s %9s %9s %6s\n",
+		"work", "engine", "over", "thr", "ops/s", "cpu s", "cpu us/op", "vcsw/op", "ivcsw/op", "util");
+
+	bench::for_engines<std::uint64_t,
+		bench::engine::Lock,
+		bench::engine::QueueLock,
+		bench::engine::Mutex,
+		bench::engine::SharedMutex,
+		bench::engine::RwLock,
+		Yield>(args, [&](auto engine) {
+		typedef typename std::remove_pointer<decltype(engine)>::type Engine;
+		for(char const * workload : { "single", "set" })
+			if(args.selects("workloads", workload))
+				for(double factor : factors)
+					run<Engine>(parameters, workload[1] == 'e', factor);
+	});
+	return 0;
+}
@@ -0,0 +1,50 @@
+namespace lock
+{
+	namespace helper
+	{
+		template<class T>
+		T * new_aligned(
+			std::size_t count)
+		{
+			std::size_t const alignment = alignof(T) > alignof(void *) ? alignof(T) : alignof(void *);
+			// the allocation's address is stored right in front of the aligned elements.
+			char * const raw = static_cast<char *>(::operator new(count * sizeof(T) + sizeof(void *) + alignment - 1));
+			std::uintptr_t const address = (reinterpret_cast<std::uintptr_t>(raw) + sizeof(void *) + alignment - 1)
+				& ~std::uintptr_t(alignment - 1);
+			T * const objects = reinterpret_cast<T *>(address);
+			reinterpret_cast<void **>(objects)[-1] = raw;
+
+			std::size_t constructed = 0;
+			try {
+				for(; constructed < count; constructed++)
+					new (objects + constructed) T();
+			} catch(...)
+			{
+				while(constructed)
+					objects[--constructed].~T();
+				::operator delete(raw);
+				throw;
+			}
+			return objects;
+		}
+
+		template<class T>
+		void delete_aligned(
+			T * objects,
+			std::size_t count)
+		{
+			if(!objects)
+				return;
+			while(count)
+				objects[--count].~T();
+			::operator delete(reinterpret_cast<void **>(objects)[-1]);
+		}
+
+		template<class T>
+		void AlignedDelete<T>::operator()(
+			T * objects) const
+		{
+			delete_aligned(objects, count);
+		}
+	}
+}
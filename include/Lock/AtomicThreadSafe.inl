@@ -0,0 +1,52 @@
+namespace lock
+{
+	template<class T, class Layout>
+	template<class ...Args>
+	ThreadSafe<T, Layout, engine::Atomic>::ThreadSafe(
+		Args&&... args):
+		m_object(T(std::forward<Args>(args)...))
+	{
+		assert(m_object.is_lock_free()
+			&& "std::atomic<T> is not lock-free on this platform.");
+	}
+
+	template<class T, class Layout>
+	ThreadSafe<T, Layout, engine::Atomic>::ThreadSafe(
+		ThreadSafe<T, Layout, engine::Atomic> && move):
+		m_object(move.m_object.load(std::memory_order_relaxed))
+	{
+	}
+
+	template<class T, class Layout>
+	T ThreadSafe<T, Layout, engine::Atomic>::load() const
+	{
+		return m_object.load(std::memory_order_acquire);
+	}
+
+	template<class T, class Layout>
+	void ThreadSafe<T, Layout, engine::Atomic>::store(
+		T const& value)
+	{
+		m_object.store(value, std::memory_order_release);
+	}
+
+	template<class T, class Layout>
+	template<class Fn>
+	T ThreadSafe<T, Layout, engine::Atomic>::update(
+		Fn &&fn)
+	{
+		T value = m_object.load(std::memory_order_acquire);
+		for(;;)
+		{
+			T modified = value;
+			fn(modified);
+			// on failure, `value` receives the current object.
+			if(m_object.compare_exchange_weak(
+				value,
+				modified,
+				std::memory_order_acq_rel,
+				std::memory_order_acquire))
+				return modified;
+		}
+	}
+}
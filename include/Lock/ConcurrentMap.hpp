@@ -0,0 +1,227 @@
+#ifndef __lock_concurrentmap_hpp_defined
+#define __lock_concurrentmap_hpp_defined
+
+#include "Lock.hpp"
+
+#include <unordered_map>
+#include <initializer_list>
+
+namespace lock
+{
+	template<
+		class K,
+		class V,
+		class Hash = std::hash<K>,
+		class KeyEqual = std::equal_to<K>>
+	class ConcurrentMap;
+
+	namespace helper
+	{
+		/** The default number of stripes of a concurrent map. */
+		constexpr std::size_t default_stripes = 64;
+
+		/** Selects a stripe by Fibonacci hashing: multiplies the hash by 2^64 / phi and takes the top `bits` bits of the product, which depend on all bits of the hash.
+			Keeps the stripe index independent of the bucket index the stripe's own table derives from the low bits of the same hash.
+		@param[in] hash:
+			The key's hash.
+		@param[in] bits:
+			The binary logarithm of the number of stripes.
+		@return
+			The stripe index, less than `2^bits`. */
+		inline std::size_t mix_hash(
+			std::uint64_t hash,
+			unsigned bits);
+	}
+
+	template<
+		class K,
+		class V,
+		class Hash,
+		class KeyEqual>
+	/** Hash map that can be accessed by multiple threads at once.
+		The keys are distributed across a fixed number of stripes, each of which is an independent hash table in its own `ThreadSafe` object. Operations on a single key only lock that key's stripe, so operations on keys in different stripes never wait for each other, and lookups only ever read lock. The number of stripes is fixed at construction; resizing happens inside the stripes: each stripe's table rehashes on its own (while it is write locked), so the map grows one stripe at a time and never stops all threads at once, but the map's concurrency does not grow with its size. Operations on multiple keys lock all involved stripes at once through `range_lock()`. */
+	class ConcurrentMap
+	{
+	public:
+		/** The hash table of a single stripe. */
+		typedef std::unordered_map<K, V, Hash, KeyEqual> Table;
+		/** A stripe. Padded so that locking one stripe does not slow down accesses to its neighbours. */
+		typedef ThreadSafe<Table, layout::Padded> Stripe;
+
+		class Transaction;
+
+	private:
+		/** The stripes. */
+		std::unique_ptr<Stripe[], helper::AlignedDelete<Stripe>> m_stripes;
+		/** The number of stripes, a power of two. */
+		std::size_t m_stripe_count;
+		/** The binary logarithm of `m_stripe_count`. */
+		unsigned m_stripe_bits;
+		/** Hashes the keys for stripe selection. */
+		Hash m_hash;
+
+	public:
+		/** Creates an empty concurrent map.
+		@param[in] stripes:
+			The number of stripes, i.e., how many threads can modify the map at once. Rounded up to a power of two. */
+		explicit ConcurrentMap(
+			std::size_t stripes = helper::default_stripes);
+
+		ConcurrentMap(
+			ConcurrentMap<K, V, Hash, KeyEqual> const&) = delete;
+		ConcurrentMap<K, V, Hash, KeyEqual> &operator=(
+			ConcurrentMap<K, V, Hash, KeyEqual> const&) = delete;
+
+		/** Inserts a value, if the key is not in the map yet.
+		@param[in] key:
+			The key to insert.
+		@param[in] value:
+			The value to insert.
+		@return
+			Whether the value was inserted. */
+		bool insert(
+			K key,
+			V value);
+
+		/** Inserts a value, or replaces the value if the key is already in the map.
+		@param[in] key:
+			The key to insert or assign.
+		@param[in] value:
+			The value to store.
+		@return
+			Whether the value was inserted (instead of assigned). */
+		bool insert_or_assign(
+			K key,
+			V value);
+
+		/** Removes a key and its value.
+		@param[in] key:
+			The key to remove.
+		@return
+			Whether the key was in the map. */
+		bool erase(
+			K const& key);
+
+		/** Copies a value out of the map.
+		@param[in] key:
+			The key to look up.
+		@param[out] value:
+			Receives the value, if the key was found.
+		@return
+			Whether the key was found. */
+		bool find(
+			K const& key,
+			V &value) const;
+
+		/** Returns whether a key is in the map. */
+		bool contains(
+			K const& key) const;
+
+		template<class Fn>
+		/** Calls a function with a value, while its stripe is read locked.
+		@param[in] key:
+			The key to look up.
+		@param[in] fn:
+			Called with a `V const&`, if the key was found. Must not access the map.
+		@return
+			Whether the key was found. */
+		bool visit(
+			K const& key,
+			Fn &&fn) const;
+
+		template<class Fn>
+		/** Calls a function with a value, while its stripe is write locked.
+		@param[in] key:
+			The key to look up.
+		@param[in] fn:
+			Called with a `V &`, if the key was found. Must not access the map.
+		@return
+			Whether the key was found. */
+		bool update(
+			K const& key,
+			Fn &&fn);
+
+		template<class Fn>
+		/** Calls a function that accesses multiple keys atomically.
+			Write locks the stripes of all given keys at once, without dead locks.
+		@param[in] keys:
+			The keys the function may access.
+		@param[in] fn:
+			Called with a `Transaction &` through which the keys can be accessed. Must not access the map directly.
+		@return
+			The return value of `fn`. */
+		auto transaction(
+			std::initializer_list<K> keys,
+			Fn &&fn) -> decltype(fn(std::declval<Transaction &>()));
+
+		/** Returns the number of entries in the map.
+			Read locks all stripes at once, so the result is exact at the time of the call. */
+		std::size_t size() const;
+
+		/** Returns the number of stripes. */
+		inline std::size_t stripes() const;
+
+	private:
+		/** Returns the index of the stripe a key belongs to. */
+		inline std::size_t stripe_of(
+			K const& key) const;
+	};
+
+	template<
+		class K,
+		class V,
+		class Hash,
+		class KeyEqual>
+	/** Accesses multiple keys of a concurrent map while their stripes are write locked.
+		Only valid within `ConcurrentMap::transaction()`, and only for the keys passed to it. */
+	class ConcurrentMap<K, V, Hash, KeyEqual>::Transaction
+	{
+		friend class ConcurrentMap<K, V, Hash, KeyEqual>;
+
+		/** The map the transaction operates on. */
+		ConcurrentMap<K, V, Hash, KeyEqual> const * m_map;
+		/** The indices of the locked stripes, sorted. */
+		std::vector<std::size_t> m_indices;
+		/** The locks on the stripes, in the same order as `m_indices`. */
+		std::vector<WriteLock<Table, layout::Padded>> m_locks;
+
+		Transaction(
+			ConcurrentMap<K, V, Hash, KeyEqual> const& map);
+	public:
+		/** Looks up a key.
+		@return
+			The value, or null if the key is not in the map. */
+		V * find(
+			K const& key);
+
+		/** Inserts a value, if the key is not in the map yet.
+		@return
+			Whether the value was inserted. */
+		bool insert(
+			K key,
+			V value);
+
+		/** Inserts a value, or replaces the value if the key is already in the map.
+		@return
+			Whether the value was inserted (instead of assigned). */
+		bool insert_or_assign(
+			K key,
+			V value);
+
+		/** Removes a key and its value.
+		@return
+			Whether the key was in the map. */
+		bool erase(
+			K const& key);
+
+	private:
+		/** Returns the locked table of a key's stripe.
+			The key must have been passed to `transaction()`. */
+		Table &table(
+			K const& key);
+	};
+}
+
+#include "ConcurrentMap.inl"
+
+#endif
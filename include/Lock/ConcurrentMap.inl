@@ -0,0 +1,230 @@
+namespace lock
+{
+	namespace helper
+	{
+		std::size_t mix_hash(
+			std::uint64_t hash,
+			unsigned bits)
+		{
+			// shifting by 64 would be undefined.
+			return bits
+				? std::size_t((hash * 0x9e3779b97f4a7c15ull) >> (64 - bits))
+				: 0;
+		}
+	}
+
+	template<class K, class V, class Hash, class KeyEqual>
+	ConcurrentMap<K, V, Hash, KeyEqual>::ConcurrentMap(
+		std::size_t stripes):
+		m_stripes(),
+		m_stripe_count(1),
+		m_stripe_bits(0),
+		m_hash()
+	{
+		while(m_stripe_count < stripes)
+		{
+			m_stripe_count <<= 1;
+			m_stripe_bits++;
+		}
+		// plain new[] ignores the stripes' cache line alignment before C++17.
+		m_stripes = std::unique_ptr<Stripe[], helper::AlignedDelete<Stripe>>(
+			helper::new_aligned<Stripe>(m_stripe_count),
+			helper::AlignedDelete<Stripe> { m_stripe_count });
+	}
+
+	template<class K, class V, class Hash, class KeyEqual>
+	bool ConcurrentMap<K, V, Hash, KeyEqual>::insert(
+		K key,
+		V value)
+	{
+		auto table = m_stripes[stripe_of(key)].write();
+		return table->emplace(std::move(key), std::move(value)).second;
+	}
+
+	template<class K, class V, class Hash, class KeyEqual>
+	bool ConcurrentMap<K, V, Hash, KeyEqual>::insert_or_assign(
+		K key,
+		V value)
+	{
+		auto table = m_stripes[stripe_of(key)].write();
+		auto it = table->find(key);
+		if(it != table->end())
+		{
+			it->second = std::move(value);
+			return false;
+		}
+		table->emplace(std::move(key), std::move(value));
+		return true;
+	}
+
+	template<class K, class V, class Hash, class KeyEqual>
+	bool ConcurrentMap<K, V, Hash, KeyEqual>::erase(
+		K const& key)
+	{
+		auto table = m_stripes[stripe_of(key)].write();
+		return table->erase(key) != 0;
+	}
+
+	template<class K, class V, class Hash, class KeyEqual>
+	bool ConcurrentMap<K, V, Hash, KeyEqual>::find(
+		K const& key,
+		V &value) const
+	{
+		return visit(key, [&value](V const& found) { value = found; });
+	}
+
+	template<class K, class V, class Hash, class KeyEqual>
+	bool ConcurrentMap<K, V, Hash, KeyEqual>::contains(
+		K const& key) const
+	{
+		auto table = m_stripes[stripe_of(key)].read();
+		return table->find(key) != table->end();
+	}
+
+	template<class K, class V, class Hash, class KeyEqual>
+	template<class Fn>
+	bool ConcurrentMap<K, V, Hash, KeyEqual>::visit(
+		K const& key,
+		Fn &&fn) const
+	{
+		auto table = m_stripes[stripe_of(key)].read();
+		auto it = table->find(key);
+		if(it == table->end())
+			return false;
+		std::forward<Fn>(fn)(it->second);
+		return true;
+	}
+
+	template<class K, class V, class Hash, class KeyEqual>
+	template<class Fn>
+	bool ConcurrentMap<K, V, Hash, KeyEqual>::update(
+		K const& key,
+		Fn &&fn)
+	{
+		auto table = m_stripes[stripe_of(key)].write();
+		auto it = table->find(key);
+		if(it == table->end())
+			return false;
+		std::forward<Fn>(fn)(it->second);
+		return true;
+	}
+
+	template<class K, class V, class Hash, class KeyEqual>
+	template<class Fn>
+	auto ConcurrentMap<K, V, Hash, KeyEqual>::transaction(
+		std::initializer_list<K> keys,
+		Fn &&fn) -> decltype(fn(std::declval<Transaction &>()))
+	{
+		Transaction transaction(*this);
+
+		for(K const& key : keys)
+			transaction.m_indices.push_back(stripe_of(key));
+		// every stripe must only be locked once.
+		std::sort(transaction.m_indices.begin(), transaction.m_indices.end());
+		transaction.m_indices.erase(
+			std::unique(transaction.m_indices.begin(), transaction.m_indices.end()),
+			transaction.m_indices.end());
+
+		transaction.m_locks.resize(transaction.m_indices.size());
+		std::vector<WriteLockPair<Table, layout::Padded>> pairs;
+		pairs.reserve(transaction.m_indices.size());
+		for(std::size_t i = 0; i < transaction.m_indices.size(); i++)
+			pairs.push_back(pair(transaction.m_locks[i], m_stripes[transaction.m_indices[i]]));
+		range_lock(range(pairs.begin(), pairs.end()));
+
+		return std::forward<Fn>(fn)(transaction);
+	}
+
+	template<class K, class V, class Hash, class KeyEqual>
+	std::size_t ConcurrentMap<K, V, Hash, KeyEqual>::size() const
+	{
+		std::vector<ReadLock<Table, layout::Padded>> locks(m_stripe_count);
+		std::vector<ReadLockPair<Table, layout::Padded>> pairs;
+		pairs.reserve(m_stripe_count);
+		for(std::size_t i = 0; i < m_stripe_count; i++)
+			pairs.push_back(pair(locks[i], m_stripes[i]));
+		range_lock(range(pairs.begin(), pairs.end()));
+
+		std::size_t size = 0;
+		for(auto const& table : locks)
+			size += table->size();
+		return size;
+	}
+
+	template<class K, class V, class Hash, class KeyEqual>
+	std::size_t ConcurrentMap<K, V, Hash, KeyEqual>::stripes() const
+	{
+		return m_stripe_count;
+	}
+
+	template<class K, class V, class Hash, class KeyEqual>
+	std::size_t ConcurrentMap<K, V, Hash, KeyEqual>::stripe_of(
+		K const& key) const
+	{
+		return helper::mix_hash(m_hash(key), m_stripe_bits);
+	}
+
+	template<class K, class V, class Hash, class KeyEqual>
+	ConcurrentMap<K, V, Hash, KeyEqual>::Transaction::Transaction(
+		ConcurrentMap<K, V, Hash, KeyEqual> const& map):
+		m_map(&map),
+		m_indices(),
+		m_locks()
+	{
+	}
+
+	template<class K, class V, class Hash, class KeyEqual>
+	V * ConcurrentMap<K, V, Hash, KeyEqual>::Transaction::find(
+		K const& key)
+	{
+		Table &locked = table(key);
+		auto it = locked.find(key);
+		return it == locked.end()
+			? nullptr
+			: std::addressof(it->second);
+	}
+
+	template<class K, class V, class Hash, class KeyEqual>
+	bool ConcurrentMap<K, V, Hash, KeyEqual>::Transaction::insert(
+		K key,
+		V value)
+	{
+		Table &locked = table(key);
+		return locked.emplace(std::move(key), std::move(value)).second;
+	}
+
+	template<class K, class V, class Hash, class KeyEqual>
+	bool ConcurrentMap<K, V, Hash, KeyEqual>::Transaction::insert_or_assign(
+		K key,
+		V value)
+	{
+		Table &locked = table(key);
+		auto it = locked.find(key);
+		if(it != locked.end())
+		{
+			it->second = std::move(value);
+			return false;
+		}
+		locked.emplace(std::move(key), std::move(value));
+		return true;
+	}
+
+	template<class K, class V, class Hash, class KeyEqual>
+	bool ConcurrentMap<K, V, Hash, KeyEqual>::Transaction::erase(
+		K const& key)
+	{
+		return table(key).erase(key) != 0;
+	}
+
+	template<class K, class V, class Hash, class KeyEqual>
+	typename ConcurrentMap<K, V, Hash, KeyEqual>::Table &ConcurrentMap<K, V, Hash, KeyEqual>::Transaction::table(
+		K const& key)
+	{
+		std::size_t const index = m_map->stripe_of(key);
+		auto it = std::lower_bound(m_indices.begin(), m_indices.end(), index);
+		assert(it != m_indices.end() && *it == index
+			&& "Tried to access a key outside of the transaction.");
+
+		return *m_locks[it - m_indices.begin()];
+	}
+}
@@ -0,0 +1,584 @@
+namespace lock
+{
+	namespace engine
+	{
+		template<bool Park>
+		LockWord<Park>::LockWord():
+			m_state(0),
+			m_read_wakeups(0),
+			m_write_wakeups(0)
+		{
+		}
+
+		template<bool Park>
+		void LockWord<Park>::wake_readers()
+		{
+			m_read_wakeups.fetch_add(1, std::memory_order_release);
+			helper::unpark_all(m_read_wakeups);
+		}
+
+		template<bool Park>
+		void LockWord<Park>::wake_writer()
+		{
+			m_write_wakeups.fetch_add(1, std::memory_order_release);
+			helper::unpark_one(m_write_wakeups);
+		}
+
+		template<bool Park>
+		std::uint32_t LockWord<Park>::blocking(
+			Access access)
+		{
+			return access == Access::read
+				? helper::state::write
+				: access == Access::upgrade
+					? helper::state::write | helper::state::upgrade
+					: helper::state::write | helper::state::upgrade | helper::state::readers;
+		}
+
+		template<bool Park>
+		bool LockWord<Park>::try_write()
+		{
+			std::uint32_t state = m_state.load(std::memory_order_relaxed);
+			while(!(state & (helper::state::write | helper::state::upgrade | helper::state::readers)))
+				if(m_state.compare_exchange_weak(
+					state,
+					state | helper::state::write,
+					std::memory_order_acquire,
+					std::memory_order_relaxed))
+					return true;
+			return false;
+		}
+
+		template<bool Park>
+		bool LockWord<Park>::try_read()
+		{
+			std::uint32_t state = m_state.load(std::memory_order_relaxed);
+			while(!(state & helper::state::write))
+			{
+				assert((state & helper::state::readers) != helper::state::readers
+					&& "Too many read locks.");
+				if(m_state.compare_exchange_weak(
+					state,
+					state + 1,
+					std::memory_order_acquire,
+					std::memory_order_relaxed))
+					return true;
+			}
+			return false;
+		}
+
+		template<bool Park>
+		bool LockWord<Park>::try_upgrade()
+		{
+			std::uint32_t state = m_state.load(std::memory_order_relaxed);
+			while(!(state & (helper::state::write | helper::state::upgrade)))
+				if(m_state.compare_exchange_weak(
+					state,
+					state | helper::state::upgrade,
+					std::memory_order_acquire,
+					std::memory_order_relaxed))
+					return true;
+			return false;
+		}
+
+		template<bool Park>
+		template<class Claim>
+		bool LockWord<Park>::lock_write(
+			Claim &&claim)
+		{
+			for(unsigned attempt = 0;; attempt++)
+			{
+				if(!claim())
+				{
+					if(attempt)
+						abandon(Access::write);
+					return false;
+				}
+				if(try_write())
+					return true;
+				wait(attempt, Access::write);
+			}
+		}
+
+		template<bool Park>
+		template<class Claim>
+		bool LockWord<Park>::lock_read(
+			Claim &&claim)
+		{
+			for(unsigned attempt = 0;; attempt++)
+			{
+				if(!claim())
+				{
+					if(attempt)
+						abandon(Access::read);
+					return false;
+				}
+				if(try_read())
+					return true;
+				wait(attempt, Access::read);
+			}
+		}
+
+		template<bool Park>
+		template<class Claim>
+		bool LockWord<Park>::lock_upgrade(
+			Claim &&claim)
+		{
+			for(unsigned attempt = 0;; attempt++)
+			{
+				if(!claim())
+				{
+					if(attempt)
+						abandon(Access::upgrade);
+					return false;
+				}
+				if(try_upgrade())
+					return true;
+				wait(attempt, Access::upgrade);
+			}
+		}
+
+		template<bool Park>
+		void LockWord<Park>::add_read()
+		{
+			m_state.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		template<bool Park>
+		void LockWord<Park>::unlock_write()
+		{
+			std::uint32_t const state = m_state.fetch_and(
+				~(helper::state::write | helper::state::waiters | helper::state::read_waiters | helper::state::write_waiters),
+				std::memory_order_release);
+
+			// all readers can enter now, but only one writer.
+			if(state & helper::state::read_waiters)
+				wake_readers();
+			if(state & helper::state::write_waiters)
+				wake_writer();
+		}
+
+		template<bool Park>
+		void LockWord<Park>::unlock_read()
+		{
+			std::uint32_t const state = m_state.fetch_sub(1, std::memory_order_release);
+
+			// only the last reader wakes anybody, as no waiting thread can make progress before.
+			if((state & helper::state::readers) != 1)
+				return;
+
+			if(state & helper::state::waiters)
+			{
+				// the write bit is set: only the thread in `upgrade()` waits, on the lock word.
+				m_state.fetch_and(~helper::state::waiters, std::memory_order_relaxed);
+				helper::unpark_all(m_state);
+			} else if((state & helper::state::write_waiters)
+			&& !(state & helper::state::write)
+			&& (m_state.fetch_and(~helper::state::write_waiters, std::memory_order_relaxed) & helper::state::write_waiters))
+				wake_writer();
+		}
+
+		template<bool Park>
+		void LockWord<Park>::unlock_upgrade()
+		{
+			std::uint32_t const state = m_state.fetch_and(
+				~(helper::state::upgrade | helper::state::write_waiters),
+				std::memory_order_release);
+
+			if(state & helper::state::write_waiters)
+				wake_writer();
+		}
+
+		template<bool Park>
+		void LockWord<Park>::upgrade()
+		{
+			// trade the upgrade bit for the write bit, which keeps new readers out.
+			std::uint32_t state = m_state.load(std::memory_order_relaxed);
+			while(!m_state.compare_exchange_weak(
+				state,
+				(state & ~helper::state::upgrade) | helper::state::write,
+				std::memory_order_relaxed));
+
+			// the write bit is set, so only the remaining readers block. The last of them wakes us.
+			for(unsigned attempt = 0; (state = m_state.load(std::memory_order_acquire)) & helper::state::readers; attempt++)
+			{
+				if(attempt < helper::spin_attempts)
+				{
+					for(unsigned i = 0; i < (1u << attempt); i++)
+						helper::cpu_relax();
+					continue;
+				}
+
+				if(!Park)
+				{
+					std::this_thread::yield();
+					continue;
+				}
+
+				if((state & helper::state::waiters)
+				|| m_state.compare_exchange_strong(
+					state,
+					state | helper::state::waiters,
+					std::memory_order_relaxed))
+					helper::park(m_state, state | helper::state::waiters);
+			}
+		}
+
+		template<bool Park>
+		void LockWord<Park>::downgrade()
+		{
+			// trade the write bit for a read lock, and admit the waiting readers. Waiting writers stay parked until the last reader leaves.
+			std::uint32_t state = m_state.load(std::memory_order_relaxed);
+			while(!m_state.compare_exchange_weak(
+				state,
+				(state & ~(helper::state::write | helper::state::waiters | helper::state::read_waiters)) + 1,
+				std::memory_order_release,
+				std::memory_order_relaxed));
+
+			if(state & helper::state::read_waiters)
+				wake_readers();
+		}
+
+		template<bool Park>
+		bool LockWord<Park>::locked() const
+		{
+			return m_state.load(std::memory_order_relaxed)
+				& (helper::state::write | helper::state::upgrade | helper::state::readers);
+		}
+
+		template<bool Park>
+		bool LockWord<Park>::blocks(
+			Access access) const
+		{
+			return m_state.load(std::memory_order_seq_cst) & blocking(access);
+		}
+
+		template<bool Park>
+		void LockWord<Park>::wait(
+			unsigned attempt,
+			Access access)
+		{
+			if(attempt < helper::spin_attempts)
+			{
+				for(unsigned i = 0; i < (1u << attempt); i++)
+					helper::cpu_relax();
+				return;
+			}
+
+			bool const read = access == Access::read;
+			std::uint32_t const waiters = read ? helper::state::read_waiters : helper::state::write_waiters;
+			std::atomic<std::uint32_t> &wakeups = read ? m_read_wakeups : m_write_wakeups;
+
+			// read before the lock word: releases clear the waiter bit before they increment the counter, so we either see the release, or it makes us return from parking.
+			std::uint32_t const seen = wakeups.load(std::memory_order_acquire);
+			std::uint32_t state = m_state.load(std::memory_order_relaxed);
+			// not blocked by the lock any more: it changed since the failed attempt.
+			if(!Park || !(state & blocking(access)))
+			{
+				std::this_thread::yield();
+				return;
+			}
+
+			if(!(state & waiters)
+			&& !m_state.compare_exchange_strong(
+				state,
+				state | waiters,
+				std::memory_order_relaxed))
+				return;
+
+			helper::park(wakeups, seen);
+
+			// a release wakes only one writer, but clears the bit for all of them: make the next release wake another one.
+			if(!read)
+				m_state.fetch_or(helper::state::write_waiters, std::memory_order_relaxed);
+		}
+
+		template<bool Park>
+		void LockWord<Park>::abandon(
+			Access access)
+		{
+			// readers are all woken at once.
+			if(access != Access::read
+			&& (m_state.load(std::memory_order_relaxed) & helper::state::write_waiters)
+			&& (m_state.fetch_and(~helper::state::write_waiters, std::memory_order_relaxed) & helper::state::write_waiters))
+				wake_writer();
+		}
+
+		Queue::Node::Node():
+			next(nullptr),
+			state(waiting),
+			access(Access::write),
+			acquire(true)
+		{
+		}
+
+		void Queue::Node::await(
+			std::uint32_t until)
+		{
+			for(unsigned attempt = 0;; attempt++)
+			{
+				std::uint32_t state = this->state.load(std::memory_order_acquire);
+				if(state == until)
+					return;
+
+				if(attempt < helper::spin_attempts)
+				{
+					for(unsigned i = 0; i < (1u << attempt); i++)
+						helper::cpu_relax();
+					continue;
+				}
+
+				if(state == parked
+				|| this->state.compare_exchange_strong(
+					state,
+					parked,
+					std::memory_order_relaxed))
+					helper::park(this->state, parked);
+			}
+		}
+
+		void Queue::Node::signal(
+			std::uint32_t state)
+		{
+			// the node's thread may return and leave its stack frame as soon as it sees the new state. Waking a dead futex word is harmless: parked threads tolerate spurious wakeups.
+			if(this->state.exchange(state, std::memory_order_release) == parked)
+				helper::unpark_all(this->state);
+		}
+
+		Queue::Queue():
+			m_word(),
+			m_tail(nullptr),
+			m_head(nullptr)
+		{
+		}
+
+		template<class Acquire>
+		bool Queue::queued(
+			Acquire &&acquire)
+		{
+			Node node;
+			if(Node * predecessor = m_tail.exchange(&node, std::memory_order_acq_rel))
+			{
+				predecessor->next.store(&node, std::memory_order_release);
+				node.await(Node::head);
+			}
+
+			bool const acquired = acquire(node);
+
+			// pass the head position on.
+			Node * next = node.next.load(std::memory_order_acquire);
+			if(!next)
+			{
+				Node * expected = &node;
+				if(m_tail.compare_exchange_strong(
+					expected,
+					nullptr,
+					std::memory_order_acq_rel,
+					std::memory_order_relaxed))
+					return acquired;
+
+				// a successor swapped itself in, but did not link itself in yet.
+				while(!(next = node.next.load(std::memory_order_acquire)))
+					helper::cpu_relax();
+			}
+			next->signal(Node::head);
+			return acquired;
+		}
+
+		template<class Claim>
+		bool Queue::acquire_at_head(
+			Node &head,
+			Access access,
+			Claim &claim)
+		{
+			head.access = access;
+			head.acquire = true;
+			for(unsigned attempt = 0;; attempt++)
+			{
+				if(!claim())
+					return false;
+				if(try_lock(access))
+					return true;
+
+				if(attempt < helper::spin_attempts)
+				{
+					for(unsigned i = 0; i < (1u << attempt); i++)
+						helper::cpu_relax();
+					continue;
+				}
+
+				if(await_handover(head))
+				{
+					// the releasing thread cannot ask `claim`: give the lock back if the object was reserved in the meantime.
+					if(claim())
+						return true;
+					unlock(access);
+					return false;
+				}
+			}
+		}
+
+		bool Queue::try_lock(
+			Access access)
+		{
+			switch(access)
+			{
+			case Access::read: return m_word.try_read();
+			case Access::upgrade: return m_word.try_upgrade();
+			default: return m_word.try_write();
+			}
+		}
+
+		void Queue::unlock(
+			Access access)
+		{
+			switch(access)
+			{
+			case Access::read: unlock_read(); break;
+			case Access::upgrade: unlock_upgrade(); break;
+			default: unlock_write(); break;
+			}
+		}
+
+		bool Queue::await_handover(
+			Node &head)
+		{
+			head.state.store(Node::waiting, std::memory_order_relaxed);
+			m_head.store(&head, std::memory_order_seq_cst);
+
+			// a release before the registration did not see it. Take the registration back, unless a releasing thread already took it: then it hands over, or registers us again.
+			if(!m_word.blocks(head.access)
+			&& m_head.exchange(nullptr, std::memory_order_relaxed))
+				return false;
+
+			head.await(Node::granted);
+			return true;
+		}
+
+		void Queue::hand_over()
+		{
+			// pairs with the registration in `await_handover()`: either we see the head, or it sees our release.
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			while(m_head.load(std::memory_order_relaxed))
+			{
+				Node * head = m_head.exchange(nullptr, std::memory_order_acquire);
+				if(!head)
+					return;
+
+				Access const access = head->access;
+				if(head->acquire
+					? try_lock(access)
+					: !m_word.blocks(access))
+				{
+					head->signal(Node::granted);
+					return;
+				}
+
+				// another thread took the lock since our release: register the head again, so that its release hands over. It may have released already, though.
+				m_head.store(head, std::memory_order_seq_cst);
+				if(m_word.blocks(access))
+					return;
+			}
+		}
+
+		bool Queue::try_write()
+		{
+			return m_word.try_write();
+		}
+
+		bool Queue::try_read()
+		{
+			return m_word.try_read();
+		}
+
+		bool Queue::try_upgrade()
+		{
+			return m_word.try_upgrade();
+		}
+
+		template<class Claim>
+		bool Queue::lock_write(
+			Claim &&claim)
+		{
+			return queued([&](Node &head) { return acquire_at_head(head, Access::write, claim); });
+		}
+
+		template<class Claim>
+		bool Queue::lock_read(
+			Claim &&claim)
+		{
+			return queued([&](Node &head) { return acquire_at_head(head, Access::read, claim); });
+		}
+
+		template<class Claim>
+		bool Queue::lock_upgrade(
+			Claim &&claim)
+		{
+			return queued([&](Node &head) { return acquire_at_head(head, Access::upgrade, claim); });
+		}
+
+		void Queue::add_read()
+		{
+			m_word.add_read();
+		}
+
+		void Queue::unlock_write()
+		{
+			m_word.unlock_write();
+			hand_over();
+		}
+
+		void Queue::unlock_read()
+		{
+			m_word.unlock_read();
+			hand_over();
+		}
+
+		void Queue::unlock_upgrade()
+		{
+			m_word.unlock_upgrade();
+			hand_over();
+		}
+
+		void Queue::upgrade()
+		{
+			m_word.upgrade();
+		}
+
+		void Queue::downgrade()
+		{
+			m_word.downgrade();
+			hand_over();
+		}
+
+		bool Queue::locked() const
+		{
+			return m_word.locked();
+		}
+
+		void Queue::wait(
+			unsigned attempt,
+			Access access)
+		{
+			if(attempt < helper::spin_attempts)
+			{
+				for(unsigned i = 0; i < (1u << attempt); i++)
+					helper::cpu_relax();
+				return;
+			}
+
+			// wait in line like `lock_*()`, but leave the lock to the caller's next attempt.
+			queued([&](Node &head) {
+				head.access = access;
+				head.acquire = false;
+				while(m_word.blocks(access) && !await_handover(head));
+				return true;
+			});
+		}
+
+		void Queue::abandon(
+			Access)
+		{
+		}
+	}
+}
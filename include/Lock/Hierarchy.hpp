@@ -0,0 +1,275 @@
+#ifndef __lock_hierarchy_hpp_defined
+#define __lock_hierarchy_hpp_defined
+
+#include "Lock.hpp"
+
+namespace lock
+{
+	template<class T>
+	class Hierarchy;
+	template<class T>
+	class HierarchyLock;
+	template<class T>
+	class HierarchyWriteLock;
+
+	namespace helper
+	{
+		/** Layout of the lock word of hierarchies.
+			Holds the exclusive bit, the waiters bit, and one holder count per shared mode. */
+		namespace intention
+		{
+			/** The lock modes of a hierarchy's parent. */
+			enum Mode
+			{
+				/** Intention to read children (IS). */
+				intend_read,
+				/** Intention to write children (IX). */
+				intend_write,
+				/** Reads the parent and all children (S). */
+				shared,
+				/** Writes the parent and all children (X). */
+				exclusive
+			};
+
+			/** Set while the parent is exclusively locked. */
+			constexpr std::uint32_t exclusive_bit = std::uint32_t(1) << 31;
+			/** Set while threads are parked on the lock word. */
+			constexpr std::uint32_t waiters = std::uint32_t(1) << 30;
+			/** The width of each holder count. */
+			constexpr unsigned count_bits = 10;
+			/** The maximum number of holders of each shared mode. */
+			constexpr std::uint32_t max_holders = (std::uint32_t(1) << count_bits) - 1;
+
+			/** Returns the amount a mode adds to the lock word. */
+			inline std::uint32_t increment(
+				Mode mode);
+			/** Returns the bits of the lock word that prevent acquiring a mode. */
+			inline std::uint32_t conflicts(
+				Mode mode);
+			/** Returns the bits of the lock word holding the count of a mode. */
+			inline std::uint32_t holders(
+				Mode mode);
+		}
+
+		struct Unguarded
+		{
+			template<class T, class Layout, class Engine>
+			/** Returns the object of a thread safe child without locking it. */
+			static T &object(
+				ThreadSafe<T, Layout, Engine> &child);
+			template<class T, class Layout, class Engine>
+			/** Returns the object of a thread safe child without locking it. */
+			static T const& object(
+				ThreadSafe<T, Layout, Engine> const& child);
+		};
+	}
+
+	template<class T>
+	/** Wrapper class for containers of `ThreadSafe` elements, with hierarchical intention locking.
+		The container (the parent) has a multi-mode lock. Before locking an element (a child) through its own `ThreadSafe`, a thread announces its intention on the parent: `intend_read()` (IS) before read locking children, `intend_write()` (IX) before write locking children. Operations on the whole container lock only the parent: `read()` (S) reads the container and all of its children without locking them, `write()` (X) modifies the container and all of its children. Thus, bulk operations take a single lock instead of locking every element through `range_lock()`, and they only wait for point operations that actually conflict with them.
+
+		Compatibility: IS is compatible with IS, IX and S. IX is compatible with IS and IX. S is compatible with IS and S. X is compatible with nothing.
+
+		Children must only be locked while holding the matching intention on their parent, and must not be used with `multi_lock` / `range_lock` together with their parent. At most `helper::intention::max_holders` threads can hold each shared mode at once; further ones wait (or fail to try-lock) until a holder leaves. */
+	class Hierarchy
+	{
+		friend class HierarchyLock<T>;
+		friend class HierarchyWriteLock<T>;
+
+		/** The container. */
+		T m_object;
+
+		/** The lock word (see `helper::intention`). */
+		std::atomic<std::uint32_t> m_state;
+
+	public:
+		template<class ...Args>
+		/** Creates a hierarchy with the given arguments.
+		@param[in] args:
+			The arguments used to construct the container. */
+		Hierarchy(
+			Args&&... args);
+
+		/** Destroys a hierarchy.
+			The hierarchy must not be locked. */
+		~Hierarchy();
+
+		Hierarchy(
+			Hierarchy<T> const&) = delete;
+		Hierarchy<T> &operator=(
+			Hierarchy<T> const&) = delete;
+
+		/** Announces the intention to read lock children (IS).
+			Blocks while the parent is write locked. */
+		HierarchyLock<T> intend_read();
+		/** Attempts to announce the intention to read lock children (IS).
+			May fail, but does not block. */
+		HierarchyLock<T> try_intend_read();
+
+		/** Announces the intention to write lock children (IX).
+			Blocks while the parent is read or write locked. */
+		HierarchyLock<T> intend_write();
+		/** Attempts to announce the intention to write lock children (IX).
+			May fail, but does not block. */
+		HierarchyLock<T> try_intend_write();
+
+		/** Read locks the parent and all children (S).
+			Blocks while any child may be write locked. */
+		HierarchyLock<T> read();
+		/** Attempts to read lock the parent and all children (S).
+			May fail, but does not block. */
+		HierarchyLock<T> try_read();
+
+		/** Write locks the parent and all children (X).
+			Blocks while the parent or any child may be locked. */
+		HierarchyWriteLock<T> write();
+		/** Attempts to write lock the parent and all children (X).
+			May fail, but does not block. */
+		HierarchyWriteLock<T> try_write();
+
+	private:
+		/** Attempts to lock the parent in the given mode. */
+		bool try_lock(
+			helper::intention::Mode mode);
+		/** Locks the parent in the given mode. */
+		void lock(
+			helper::intention::Mode mode);
+		/** Releases the parent in the given mode and wakes parked threads if that unblocks them. */
+		void unlock(
+			helper::intention::Mode mode);
+	};
+
+	template<class T>
+	/** Scoped IS, IX or S lock on a hierarchy.
+		Grants read access to the container. In S mode, also grants read access to all children without locking them. */
+	class HierarchyLock
+	{
+		friend class Hierarchy<T>;
+
+		/** The hierarchy this lock is bound to. */
+		Hierarchy<T> * m_proxy;
+		/** The mode the parent is locked in. */
+		helper::intention::Mode m_mode;
+
+		HierarchyLock(
+			Hierarchy<T> &proxy,
+			helper::intention::Mode mode);
+	public:
+		/** Creates an empty lock. */
+		HierarchyLock();
+		/** Moves the lock ownership from `move`.
+		@param[in,out] move:
+			The lock to move. */
+		HierarchyLock(
+			HierarchyLock<T> &&move);
+		/** Releases the lock. */
+		~HierarchyLock();
+
+		HierarchyLock(
+			HierarchyLock<T> const&) = delete;
+		HierarchyLock<T> &operator=(
+			HierarchyLock<T> const&) = delete;
+
+		/** Moves a lock.
+			Unlocks `this` if it is not empty.
+		@param[in,out] move:
+			The lock to move.
+		@return
+			A reference to `this`. */
+		HierarchyLock<T> &operator=(
+			HierarchyLock<T> &&move);
+
+		/** Accesses the container. */
+		inline T const* operator->() const;
+		/** Accesses the container. */
+		inline T const& operator*() const;
+
+		template<class U, class Layout, class Engine>
+		/** Returns a child, so that it can be locked.
+			Only allowed in intention modes (`Hierarchy::intend_read()`, `Hierarchy::intend_write()`). In IS mode, the child must only be read locked.
+		@param[in] child:
+			A child of the locked container. */
+		inline ThreadSafe<U, Layout, Engine> &child(
+			ThreadSafe<U, Layout, Engine> const& child) const;
+
+		template<class U, class Layout, class Engine>
+		/** Accesses a child without locking it.
+			Only allowed in S mode (`Hierarchy::read()`).
+		@param[in] child:
+			A child of the locked container. */
+		inline U const& get(
+			ThreadSafe<U, Layout, Engine> const& child) const;
+
+		/** Returns whether the lock is bound to any hierarchy. */
+		inline bool locked() const;
+		/** Same as `locked()`. */
+		inline operator bool() const;
+
+		/** Releases the lock.
+			The hierarchy must be locked. */
+		inline void unlock();
+	};
+
+	template<class T>
+	/** Scoped X lock on a hierarchy.
+		Grants write access to the container and to all children without locking them. */
+	class HierarchyWriteLock
+	{
+		friend class Hierarchy<T>;
+
+		/** The hierarchy this lock is bound to. */
+		Hierarchy<T> * m_proxy;
+
+		HierarchyWriteLock(
+			Hierarchy<T> &proxy);
+	public:
+		/** Creates an empty lock. */
+		HierarchyWriteLock();
+		/** Moves the lock ownership from `move`.
+		@param[in,out] move:
+			The lock to move. */
+		HierarchyWriteLock(
+			HierarchyWriteLock<T> &&move);
+		/** Releases the lock. */
+		~HierarchyWriteLock();
+
+		HierarchyWriteLock(
+			HierarchyWriteLock<T> const&) = delete;
+		HierarchyWriteLock<T> &operator=(
+			HierarchyWriteLock<T> const&) = delete;
+
+		/** Moves a lock.
+			Unlocks `this` if it is not empty.
+		@param[in,out] move:
+			The lock to move.
+		@return
+			A reference to `this`. */
+		HierarchyWriteLock<T> &operator=(
+			HierarchyWriteLock<T> &&move);
+
+		/** Accesses the container. */
+		inline T * operator->();
+		/** Accesses the container. */
+		inline T & operator*();
+
+		template<class U, class Layout, class Engine>
+		/** Accesses a child without locking it.
+		@param[in] child:
+			A child of the locked container. */
+		inline U &get(
+			ThreadSafe<U, Layout, Engine> &child);
+
+		/** Returns whether the lock is bound to any hierarchy. */
+		inline bool locked() const;
+		/** Same as `locked()`. */
+		inline operator bool() const;
+
+		/** Releases the lock.
+			The hierarchy must be locked. */
+		inline void unlock();
+	};
+}
+
+#include "Hierarchy.inl"
+
+#endif
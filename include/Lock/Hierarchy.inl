@@ -0,0 +1,406 @@
+namespace lock
+{
+	namespace helper
+	{
+		namespace intention
+		{
+			std::uint32_t increment(
+				Mode mode)
+			{
+				switch(mode)
+				{
+				case shared: return 1;
+				case intend_read: return std::uint32_t(1) << count_bits;
+				case intend_write: return std::uint32_t(1) << (2 * count_bits);
+				default: return exclusive_bit;
+				}
+			}
+
+			std::uint32_t holders(
+				Mode mode)
+			{
+				return mode == exclusive
+					? exclusive_bit
+					: increment(mode) * max_holders;
+			}
+
+			std::uint32_t conflicts(
+				Mode mode)
+			{
+				switch(mode)
+				{
+				case intend_read: return exclusive_bit;
+				case intend_write: return exclusive_bit | holders(shared);
+				case shared: return exclusive_bit | holders(intend_write);
+				default: return exclusive_bit | holders(shared) | holders(intend_read) | holders(intend_write);
+				}
+			}
+		}
+
+		template<class T, class Layout, class Engine>
+		T &Unguarded::object(
+			ThreadSafe<T, Layout, Engine> &child)
+		{
+			return child.m_object;
+		}
+
+		template<class T, class Layout, class Engine>
+		T const& Unguarded::object(
+			ThreadSafe<T, Layout, Engine> const& child)
+		{
+			return child.m_object;
+		}
+	}
+
+	template<class T>
+	template<class ...Args>
+	Hierarchy<T>::Hierarchy(
+		Args&&... args):
+		m_object(std::forward<Args>(args)...),
+		m_state(0)
+	{
+	}
+
+	template<class T>
+	Hierarchy<T>::~Hierarchy()
+	{
+		assert(!(m_state.load(std::memory_order_relaxed) & ~helper::intention::waiters)
+			&& "Tried to destroy a locked hierarchy.");
+	}
+
+	template<class T>
+	HierarchyLock<T> Hierarchy<T>::intend_read()
+	{
+		lock(helper::intention::intend_read);
+		return HierarchyLock<T>(*this, helper::intention::intend_read);
+	}
+
+	template<class T>
+	HierarchyLock<T> Hierarchy<T>::try_intend_read()
+	{
+		if(try_lock(helper::intention::intend_read))
+			return HierarchyLock<T>(*this, helper::intention::intend_read);
+		else
+			return HierarchyLock<T>();
+	}
+
+	template<class T>
+	HierarchyLock<T> Hierarchy<T>::intend_write()
+	{
+		lock(helper::intention::intend_write);
+		return HierarchyLock<T>(*this, helper::intention::intend_write);
+	}
+
+	template<class T>
+	HierarchyLock<T> Hierarchy<T>::try_intend_write()
+	{
+		if(try_lock(helper::intention::intend_write))
+			return HierarchyLock<T>(*this, helper::intention::intend_write);
+		else
+			return HierarchyLock<T>();
+	}
+
+	template<class T>
+	HierarchyLock<T> Hierarchy<T>::read()
+	{
+		lock(helper::intention::shared);
+		return HierarchyLock<T>(*this, helper::intention::shared);
+	}
+
+	template<class T>
+	HierarchyLock<T> Hierarchy<T>::try_read()
+	{
+		if(try_lock(helper::intention::shared))
+			return HierarchyLock<T>(*this, helper::intention::shared);
+		else
+			return HierarchyLock<T>();
+	}
+
+	template<class T>
+	HierarchyWriteLock<T> Hierarchy<T>::write()
+	{
+		lock(helper::intention::exclusive);
+		return HierarchyWriteLock<T>(*this);
+	}
+
+	template<class T>
+	HierarchyWriteLock<T> Hierarchy<T>::try_write()
+	{
+		if(try_lock(helper::intention::exclusive))
+			return HierarchyWriteLock<T>(*this);
+		else
+			return HierarchyWriteLock<T>();
+	}
+
+	template<class T>
+	bool Hierarchy<T>::try_lock(
+		helper::intention::Mode mode)
+	{
+		std::uint32_t state = m_state.load(std::memory_order_relaxed);
+		do {
+			if(state & helper::intention::conflicts(mode))
+				return false;
+			// a full holder count would overflow into the next field: back off until a holder leaves.
+			if((state & helper::intention::holders(mode)) == helper::intention::holders(mode))
+				return false;
+		} while(!m_state.compare_exchange_weak(
+			state,
+			state + helper::intention::increment(mode),
+			std::memory_order_acquire,
+			std::memory_order_relaxed));
+		return true;
+	}
+
+	template<class T>
+	void Hierarchy<T>::lock(
+		helper::intention::Mode mode)
+	{
+		for(unsigned attempt = 0; !try_lock(mode); attempt++)
+		{
+			if(attempt < helper::spin_attempts)
+			{
+				for(unsigned i = 0; i < (1u << attempt); i++)
+					helper::cpu_relax();
+				continue;
+			}
+
+			// only conflicts park: releases do not wake threads blocked by a full holder count.
+			std::uint32_t state = m_state.load(std::memory_order_relaxed);
+			if(!(state & helper::intention::conflicts(mode)))
+			{
+				std::this_thread::yield();
+				continue;
+			}
+
+			if(!(state & helper::intention::waiters)
+			&& !m_state.compare_exchange_strong(
+				state,
+				state | helper::intention::waiters,
+				std::memory_order_relaxed))
+				continue;
+
+			helper::park(m_state, state | helper::intention::waiters);
+		}
+	}
+
+	template<class T>
+	void Hierarchy<T>::unlock(
+		helper::intention::Mode mode)
+	{
+		std::uint32_t const state = m_state.fetch_sub(
+			helper::intention::increment(mode),
+			std::memory_order_release);
+
+		// waiters can only be unblocked once the last holder of a mode leaves.
+		if((state & helper::intention::waiters)
+		&& !((state - helper::intention::increment(mode)) & helper::intention::holders(mode)))
+		{
+			m_state.fetch_and(~helper::intention::waiters, std::memory_order_relaxed);
+			helper::unpark_all(m_state);
+		}
+	}
+
+	template<class T>
+	HierarchyLock<T>::HierarchyLock(
+		Hierarchy<T> &proxy,
+		helper::intention::Mode mode):
+		m_proxy(&proxy),
+		m_mode(mode)
+	{
+	}
+
+	template<class T>
+	HierarchyLock<T>::HierarchyLock():
+		m_proxy(nullptr),
+		m_mode(helper::intention::intend_read)
+	{
+	}
+
+	template<class T>
+	HierarchyLock<T>::HierarchyLock(
+		HierarchyLock<T> &&move):
+		m_proxy(move.m_proxy),
+		m_mode(move.m_mode)
+	{
+		move.m_proxy = nullptr;
+	}
+
+	template<class T>
+	HierarchyLock<T>::~HierarchyLock()
+	{
+		if(locked())
+			m_proxy->unlock(m_mode);
+	}
+
+	template<class T>
+	HierarchyLock<T> &HierarchyLock<T>::operator=(
+		HierarchyLock<T> &&move)
+	{
+		if(&move == this)
+			return *this;
+
+		if(locked())
+			m_proxy->unlock(m_mode);
+
+		m_proxy = move.m_proxy;
+		m_mode = move.m_mode;
+		move.m_proxy = nullptr;
+
+		return *this;
+	}
+
+	template<class T>
+	T const * HierarchyLock<T>::operator->() const
+	{
+		assert(locked()
+			&& "Tried to access empty lock.");
+		return std::addressof(m_proxy->m_object);
+	}
+
+	template<class T>
+	T const& HierarchyLock<T>::operator*() const
+	{
+		assert(locked()
+			&& "Tried to access empty lock.");
+		return m_proxy->m_object;
+	}
+
+	template<class T>
+	template<class U, class Layout, class Engine>
+	ThreadSafe<U, Layout, Engine> &HierarchyLock<T>::child(
+		ThreadSafe<U, Layout, Engine> const& child) const
+	{
+		assert(locked()
+			&& "Tried to access empty lock.");
+		assert(m_mode != helper::intention::shared
+			&& "Tried to lock a child through a shared lock.");
+		// the container is only const to prevent structural changes, the child's own lock protects its object.
+		return const_cast<ThreadSafe<U, Layout, Engine> &>(child);
+	}
+
+	template<class T>
+	template<class U, class Layout, class Engine>
+	U const& HierarchyLock<T>::get(
+		ThreadSafe<U, Layout, Engine> const& child) const
+	{
+		assert(locked()
+			&& "Tried to access empty lock.");
+		assert(m_mode == helper::intention::shared
+			&& "Tried to access an unlocked child through an intention lock.");
+		return helper::Unguarded::object(child);
+	}
+
+	template<class T>
+	bool HierarchyLock<T>::locked() const
+	{
+		return m_proxy != nullptr;
+	}
+
+	template<class T>
+	HierarchyLock<T>::operator bool() const
+	{
+		return locked();
+	}
+
+	template<class T>
+	void HierarchyLock<T>::unlock()
+	{
+		assert(locked()
+			&& "Tried to unlock empty lock.");
+
+		m_proxy->unlock(m_mode);
+		m_proxy = nullptr;
+	}
+
+	template<class T>
+	HierarchyWriteLock<T>::HierarchyWriteLock(
+		Hierarchy<T> &proxy):
+		m_proxy(&proxy)
+	{
+	}
+
+	template<class T>
+	HierarchyWriteLock<T>::HierarchyWriteLock():
+		m_proxy(nullptr)
+	{
+	}
+
+	template<class T>
+	HierarchyWriteLock<T>::HierarchyWriteLock(
+		HierarchyWriteLock<T> &&move):
+		m_proxy(move.m_proxy)
+	{
+		move.m_proxy = nullptr;
+	}
+
+	template<class T>
+	HierarchyWriteLock<T>::~HierarchyWriteLock()
+	{
+		if(locked())
+			m_proxy->unlock(helper::intention::exclusive);
+	}
+
+	template<class T>
+	HierarchyWriteLock<T> &HierarchyWriteLock<T>::operator=(
+		HierarchyWriteLock<T> &&move)
+	{
+		if(&move == this)
+			return *this;
+
+		if(locked())
+			m_proxy->unlock(helper::intention::exclusive);
+
+		m_proxy = move.m_proxy;
+		move.m_proxy = nullptr;
+
+		return *this;
+	}
+
+	template<class T>
+	T * HierarchyWriteLock<T>::operator->()
+	{
+		assert(locked()
+			&& "Tried to access empty lock.");
+		return std::addressof(m_proxy->m_object);
+	}
+
+	template<class T>
+	T &HierarchyWriteLock<T>::operator*()
+	{
+		assert(locked()
+			&& "Tried to access empty lock.");
+		return m_proxy->m_object;
+	}
+
+	template<class T>
+	template<class U, class Layout, class Engine>
+	U &HierarchyWriteLock<T>::get(
+		ThreadSafe<U, Layout, Engine> &child)
+	{
+		assert(locked()
+			&& "Tried to access empty lock.");
+		return helper::Unguarded::object(child);
+	}
+
+	template<class T>
+	bool HierarchyWriteLock<T>::locked() const
+	{
+		return m_proxy != nullptr;
+	}
+
+	template<class T>
+	HierarchyWriteLock<T>::operator bool() const
+	{
+		return locked();
+	}
+
+	template<class T>
+	void HierarchyWriteLock<T>::unlock()
+	{
+		assert(locked()
+			&& "Tried to unlock empty lock.");
+
+		m_proxy->unlock(helper::intention::exclusive);
+		m_proxy = nullptr;
+	}
+}
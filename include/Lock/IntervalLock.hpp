@@ -0,0 +1,267 @@
+#ifndef __lock_intervallock_hpp_defined
+#define __lock_intervallock_hpp_defined
+
+#include "Lock.hpp"
+
+namespace lock
+{
+	class IntervalLock;
+	class IntervalReadLock;
+	class IntervalWriteLock;
+
+	namespace helper
+	{
+		/** The number of shards of an interval lock. */
+		constexpr std::size_t interval_shards = 32;
+	}
+
+	/** Read / write locks on half-open index ranges of a single large resource.
+		Use this to let threads work on disjoint regions of one buffer (e.g., a memory mapped array) without a `ThreadSafe` per element. The resource itself is not owned by the interval lock. Overlapping read locks coexist, a write lock excludes every other lock overlapping it. Empty ranges never conflict, and do not touch the interval lock at all.
+		The index space is cut into granules of a fixed number of indices, and the granules are spread over `helper::interval_shards` shards, each on its own cache line with its own mutex and lists of held and queued ranges. A range is locked in every shard one of its granules maps to, in ascending shard order, so that ranges in different granules mostly do not share a mutex, and every list only holds the ranges that touch its shard. Blocked requests are queued per shard in arrival order: a request waits for every overlapping, conflicting request queued before it, so writers are not starved by readers. When a lock is released, exactly those queued requests that can now proceed are granted their range in that shard and woken. Cannot be used with `multi_lock` or `range_lock`: to lock multiple ranges at once, lock a single range covering them. */
+	class IntervalLock
+	{
+		friend class IntervalReadLock;
+		friend class IntervalWriteLock;
+
+		/** A locked or requested range. */
+		struct Interval
+		{
+			/** The first index of the range. */
+			std::size_t begin;
+			/** The index past the last index of the range. */
+			std::size_t end;
+			/** Whether the range is write locked. */
+			bool write;
+
+			/** Returns whether two ranges cannot be locked at the same time. Empty ranges never conflict. */
+			inline bool conflicts(
+				Interval const& other) const;
+		};
+
+		/** A blocked request, living on the requesting thread's stack. */
+		struct Waiter
+		{
+			/** The requested range. */
+			Interval interval;
+			/** Set to 1 once the range was locked on behalf of the waiter. The waiter parks on it. */
+			std::atomic<std::uint32_t> granted;
+		};
+
+		/** The held and queued ranges that touch one shard. */
+		struct alignas(helper::cache_line) Shard
+		{
+			/** Protects the held and queued ranges. */
+			std::mutex mutex;
+			/** The currently locked ranges. */
+			std::vector<Interval> held;
+			/** The blocked requests, in arrival order. */
+			std::vector<Waiter *> waiters;
+
+			/** Returns whether a range can be locked right now, i.e., whether it conflicts with neither a held range, nor one of the first `queued` queued requests. */
+			inline bool available(
+				Interval const& interval,
+				std::size_t queued) const;
+			/** Locks a range in this shard.
+			@param[in] interval:
+				The range to lock.
+			@param[in] block:
+				Whether to wait if the range is not available.
+			@return
+				Whether the range was locked. */
+			inline bool acquire(
+				Interval const& interval,
+				bool block);
+			/** Unlocks a range in this shard and grants the queued requests that became available. */
+			inline void release(
+				Interval const& interval);
+		};
+
+		/** The number of indices per granule. */
+		std::size_t m_granularity;
+		/** The shards. Granule `i` maps to shard `i % helper::interval_shards`. */
+		Shard m_shards[helper::interval_shards];
+
+	public:
+		/** Creates an interval lock without any locked ranges.
+		@param[in] granularity:
+			The number of indices per granule. Ranges within the same granule always share a shard; choose it around the size of a typical range. */
+		inline explicit IntervalLock(
+			std::size_t granularity = 4096);
+		/** Destroys an interval lock.
+			No range may be locked. */
+		inline ~IntervalLock();
+
+		IntervalLock(
+			IntervalLock const&) = delete;
+		IntervalLock &operator=(
+			IntervalLock const&) = delete;
+
+		/** Read locks a range.
+			Blocks until no overlapping range is write locked or waiting to be write locked.
+		@param[in] begin:
+			The first index of the range.
+		@param[in] end:
+			The index past the last index of the range. */
+		inline IntervalReadLock read(
+			std::size_t begin,
+			std::size_t end);
+		/** Attempts to read lock a range.
+			May fail, but does not block. */
+		inline IntervalReadLock try_read(
+			std::size_t begin,
+			std::size_t end);
+
+		/** Write locks a range.
+			Blocks until no overlapping range is locked or waiting to be locked.
+		@param[in] begin:
+			The first index of the range.
+		@param[in] end:
+			The index past the last index of the range. */
+		inline IntervalWriteLock write(
+			std::size_t begin,
+			std::size_t end);
+		/** Attempts to write lock a range.
+			May fail, but does not block. */
+		inline IntervalWriteLock try_write(
+			std::size_t begin,
+			std::size_t end);
+
+	private:
+		template<class Fn>
+		/** Calls `fn` with every shard a non-empty range touches, in ascending order, until it returns false.
+		@return
+			Whether `fn` returned true for every shard. */
+		bool for_each_shard(
+			Interval const& interval,
+			Fn &&fn);
+		/** Locks a range in all its shards.
+		@param[in] interval:
+			The range to lock.
+		@param[in] block:
+			Whether to wait if the range is not available.
+		@return
+			Whether the range was locked. */
+		inline bool acquire(
+			Interval const& interval,
+			bool block);
+		/** Unlocks a range in all its shards. */
+		inline void release(
+			Interval const& interval);
+	};
+
+	/** Scoped read lock on a range of an interval lock. */
+	class IntervalReadLock
+	{
+		friend class IntervalLock;
+
+		/** The interval lock this lock is bound to. */
+		IntervalLock * m_proxy;
+		/** The first index of the locked range. */
+		std::size_t m_begin;
+		/** The index past the last index of the locked range. */
+		std::size_t m_end;
+
+		inline IntervalReadLock(
+			IntervalLock &proxy,
+			std::size_t begin,
+			std::size_t end);
+	public:
+		/** Creates an empty lock. */
+		inline IntervalReadLock();
+		/** Moves the lock ownership from `move`.
+		@param[in,out] move:
+			The lock to move. */
+		inline IntervalReadLock(
+			IntervalReadLock &&move);
+		/** Releases the lock. */
+		inline ~IntervalReadLock();
+
+		IntervalReadLock(
+			IntervalReadLock const&) = delete;
+		IntervalReadLock &operator=(
+			IntervalReadLock const&) = delete;
+
+		/** Moves a lock.
+			Unlocks `this` if it is not empty.
+		@param[in,out] move:
+			The lock to move.
+		@return
+			A reference to `this`. */
+		inline IntervalReadLock &operator=(
+			IntervalReadLock &&move);
+
+		/** The first index of the locked range. */
+		inline std::size_t begin() const;
+		/** The index past the last index of the locked range. */
+		inline std::size_t end() const;
+
+		/** Returns whether the lock is bound to any interval lock. */
+		inline bool locked() const;
+		/** Same as `locked()`. */
+		inline operator bool() const;
+
+		/** Releases the lock.
+			The range must be locked. */
+		inline void unlock();
+	};
+
+	/** Scoped write lock on a range of an interval lock. */
+	class IntervalWriteLock
+	{
+		friend class IntervalLock;
+
+		/** The interval lock this lock is bound to. */
+		IntervalLock * m_proxy;
+		/** The first index of the locked range. */
+		std::size_t m_begin;
+		/** The index past the last index of the locked range. */
+		std::size_t m_end;
+
+		inline IntervalWriteLock(
+			IntervalLock &proxy,
+			std::size_t begin,
+			std::size_t end);
+	public:
+		/** Creates an empty lock. */
+		inline IntervalWriteLock();
+		/** Moves the lock ownership from `move`.
+		@param[in,out] move:
+			The lock to move. */
+		inline IntervalWriteLock(
+			IntervalWriteLock &&move);
+		/** Releases the lock. */
+		inline ~IntervalWriteLock();
+
+		IntervalWriteLock(
+			IntervalWriteLock const&) = delete;
+		IntervalWriteLock &operator=(
+			IntervalWriteLock const&) = delete;
+
+		/** Moves a lock.
+			Unlocks `this` if it is not empty.
+		@param[in,out] move:
+			The lock to move.
+		@return
+			A reference to `this`. */
+		inline IntervalWriteLock &operator=(
+			IntervalWriteLock &&move);
+
+		/** The first index of the locked range. */
+		inline std::size_t begin() const;
+		/** The index past the last index of the locked range. */
+		inline std::size_t end() const;
+
+		/** Returns whether the lock is bound to any interval lock. */
+		inline bool locked() const;
+		/** Same as `locked()`. */
+		inline operator bool() const;
+
+		/** Releases the lock.
+			The range must be locked. */
+		inline void unlock();
+	};
+}
+
+#include "IntervalLock.inl"
+
+#endif
@@ -0,0 +1,362 @@
+namespace lock
+{
+	bool IntervalLock::Interval::conflicts(
+		Interval const& other) const
+	{
+		return (write || other.write)
+			&& begin < end
+			&& other.begin < other.end
+			&& begin < other.end
+			&& other.begin < end;
+	}
+
+	bool IntervalLock::Shard::available(
+		Interval const& interval,
+		std::size_t queued) const
+	{
+		for(auto const& other : held)
+			if(interval.conflicts(other))
+				return false;
+		for(std::size_t i = 0; i < queued; i++)
+			if(interval.conflicts(waiters[i]->interval))
+				return false;
+		return true;
+	}
+
+	bool IntervalLock::Shard::acquire(
+		Interval const& interval,
+		bool block)
+	{
+		Waiter waiter;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if(available(interval, waiters.size()))
+			{
+				held.push_back(interval);
+				return true;
+			}
+
+			if(!block)
+				return false;
+
+			waiter.interval = interval;
+			waiter.granted.store(0, std::memory_order_relaxed);
+			waiters.push_back(&waiter);
+		}
+
+		// release() locks the range on our behalf before waking us.
+		while(!waiter.granted.load(std::memory_order_acquire))
+			helper::park(waiter.granted, 0);
+		return true;
+	}
+
+	void IntervalLock::Shard::release(
+		Interval const& interval)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		for(auto it = held.begin(); it != held.end(); it++)
+			if(it->begin == interval.begin
+			&& it->end == interval.end
+			&& it->write == interval.write)
+			{
+				*it = held.back();
+				held.pop_back();
+				break;
+			}
+
+		// only wake the requests that no longer conflict with anything held or queued before them.
+		for(std::size_t i = 0; i < waiters.size();)
+		{
+			Waiter &waiter = *waiters[i];
+			if(available(waiter.interval, i))
+			{
+				held.push_back(waiter.interval);
+				waiters.erase(waiters.begin() + i);
+				// the waiter may return and leave its stack frame as soon as it sees the grant. Waking a dead futex word is harmless: parked threads tolerate spurious wakeups.
+				waiter.granted.store(1, std::memory_order_release);
+				helper::unpark_all(waiter.granted);
+			} else
+				i++;
+		}
+	}
+
+	IntervalLock::IntervalLock(
+		std::size_t granularity):
+		m_granularity(granularity)
+	{
+		assert(granularity
+			&& "The granularity must not be zero.");
+	}
+
+	IntervalLock::~IntervalLock()
+	{
+#ifndef NDEBUG
+		for(auto const& shard : m_shards)
+			assert(shard.held.empty() && shard.waiters.empty()
+				&& "Tried to destroy a locked interval lock.");
+#endif
+	}
+
+	IntervalReadLock IntervalLock::read(
+		std::size_t begin,
+		std::size_t end)
+	{
+		acquire(Interval{begin, end, false}, true);
+		return IntervalReadLock(*this, begin, end);
+	}
+
+	IntervalReadLock IntervalLock::try_read(
+		std::size_t begin,
+		std::size_t end)
+	{
+		if(acquire(Interval{begin, end, false}, false))
+			return IntervalReadLock(*this, begin, end);
+		else
+			return IntervalReadLock();
+	}
+
+	IntervalWriteLock IntervalLock::write(
+		std::size_t begin,
+		std::size_t end)
+	{
+		acquire(Interval{begin, end, true}, true);
+		return IntervalWriteLock(*this, begin, end);
+	}
+
+	IntervalWriteLock IntervalLock::try_write(
+		std::size_t begin,
+		std::size_t end)
+	{
+		if(acquire(Interval{begin, end, true}, false))
+			return IntervalWriteLock(*this, begin, end);
+		else
+			return IntervalWriteLock();
+	}
+
+	template<class Fn>
+	bool IntervalLock::for_each_shard(
+		Interval const& interval,
+		Fn &&fn)
+	{
+		std::size_t const first = interval.begin / m_granularity;
+		std::size_t const last = (interval.end - 1) / m_granularity;
+
+		// the range's granules cover every shard, one contiguous run of shards, or two if they wrap around.
+		std::size_t from = 0, to = helper::interval_shards - 1;
+		if(last - first < helper::interval_shards - 1)
+		{
+			from = first % helper::interval_shards;
+			to = last % helper::interval_shards;
+		}
+
+		if(from > to)
+		{
+			for(std::size_t i = 0; i <= to; i++)
+				if(!fn(m_shards[i]))
+					return false;
+			to = helper::interval_shards - 1;
+		}
+		for(std::size_t i = from; i <= to; i++)
+			if(!fn(m_shards[i]))
+				return false;
+		return true;
+	}
+
+	bool IntervalLock::acquire(
+		Interval const& interval,
+		bool block)
+	{
+		assert(interval.begin <= interval.end
+			&& "Tried to lock an invalid range.");
+
+		if(interval.begin == interval.end)
+			return true;
+
+		// blocking in one shard while holding lower ones cannot deadlock, as every range locks its shards in the same order.
+		Shard * failed = nullptr;
+		if(for_each_shard(interval, [&](Shard &shard) {
+				if(shard.acquire(interval, block))
+					return true;
+				failed = &shard;
+				return false;
+			}))
+			return true;
+
+		for_each_shard(interval, [&](Shard &shard) {
+			if(&shard == failed)
+				return false;
+			shard.release(interval);
+			return true;
+		});
+		return false;
+	}
+
+	void IntervalLock::release(
+		Interval const& interval)
+	{
+		if(interval.begin == interval.end)
+			return;
+
+		for_each_shard(interval, [&](Shard &shard) {
+			shard.release(interval);
+			return true;
+		});
+	}
+
+	IntervalReadLock::IntervalReadLock(
+		IntervalLock &proxy,
+		std::size_t begin,
+		std::size_t end):
+		m_proxy(&proxy),
+		m_begin(begin),
+		m_end(end)
+	{
+	}
+
+	IntervalReadLock::IntervalReadLock():
+		m_proxy(nullptr),
+		m_begin(0),
+		m_end(0)
+	{
+	}
+
+	IntervalReadLock::IntervalReadLock(
+		IntervalReadLock &&move):
+		m_proxy(move.m_proxy),
+		m_begin(move.m_begin),
+		m_end(move.m_end)
+	{
+		move.m_proxy = nullptr;
+	}
+
+	IntervalReadLock::~IntervalReadLock()
+	{
+		if(locked())
+			m_proxy->release(IntervalLock::Interval{m_begin, m_end, false});
+	}
+
+	IntervalReadLock &IntervalReadLock::operator=(
+		IntervalReadLock &&move)
+	{
+		if(&move == this)
+			return *this;
+
+		if(locked())
+			m_proxy->release(IntervalLock::Interval{m_begin, m_end, false});
+
+		m_proxy = move.m_proxy;
+		m_begin = move.m_begin;
+		m_end = move.m_end;
+		move.m_proxy = nullptr;
+
+		return *this;
+	}
+
+	std::size_t IntervalReadLock::begin() const
+	{
+		return m_begin;
+	}
+
+	std::size_t IntervalReadLock::end() const
+	{
+		return m_end;
+	}
+
+	bool IntervalReadLock::locked() const
+	{
+		return m_proxy != nullptr;
+	}
+
+	IntervalReadLock::operator bool() const
+	{
+		return locked();
+	}
+
+	void IntervalReadLock::unlock()
+	{
+		assert(locked()
+			&& "Tried to unlock empty lock.");
+
+		m_proxy->release(IntervalLock::Interval{m_begin, m_end, false});
+		m_proxy = nullptr;
+	}
+
+	IntervalWriteLock::IntervalWriteLock(
+		IntervalLock &proxy,
+		std::size_t begin,
+		std::size_t end):
+		m_proxy(&proxy),
+		m_begin(begin),
+		m_end(end)
+	{
+	}
+
+	IntervalWriteLock::IntervalWriteLock():
+		m_proxy(nullptr),
+		m_begin(0),
+		m_end(0)
+	{
+	}
+
+	IntervalWriteLock::IntervalWriteLock(
+		IntervalWriteLock &&move):
+		m_proxy(move.m_proxy),
+		m_begin(move.m_begin),
+		m_end(move.m_end)
+	{
+		move.m_proxy = nullptr;
+	}
+
+	IntervalWriteLock::~IntervalWriteLock()
+	{
+		if(locked())
+			m_proxy->release(IntervalLock::Interval{m_begin, m_end, true});
+	}
+
+	IntervalWriteLock &IntervalWriteLock::operator=(
+		IntervalWriteLock &&move)
+	{
+		if(&move == this)
+			return *this;
+
+		if(locked())
+			m_proxy->release(IntervalLock::Interval{m_begin, m_end, true});
+
+		m_proxy = move.m_proxy;
+		m_begin = move.m_begin;
+		m_end = move.m_end;
+		move.m_proxy = nullptr;
+
+		return *this;
+	}
+
+	std::size_t IntervalWriteLock::begin() const
+	{
+		return m_begin;
+	}
+
+	std::size_t IntervalWriteLock::end() const
+	{
+		return m_end;
+	}
+
+	bool IntervalWriteLock::locked() const
+	{
+		return m_proxy != nullptr;
+	}
+
+	IntervalWriteLock::operator bool() const
+	{
+		return locked();
+	}
+
+	void IntervalWriteLock::unlock()
+	{
+		assert(locked()
+			&& "Tried to unlock empty lock.");
+
+		m_proxy->release(IntervalLock::Interval{m_begin, m_end, true});
+		m_proxy = nullptr;
+	}
+}
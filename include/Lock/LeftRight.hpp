@@ -0,0 +1,157 @@
+#ifndef __lock_leftright_hpp_defined
+#define __lock_leftright_hpp_defined
+
+#include "ShardedThreadSafe.hpp"
+
+namespace lock
+{
+	template<class T>
+	class LeftRight;
+	template<class T>
+	class LeftRightReadLock;
+
+	template<class T>
+	/** Wrapper class for shared resources using Left-Right concurrency control.
+		Keeps two replicas of the object. Readers are wait-free: they announce themselves on a per-thread-slot read indicator and read whichever replica is currently active. A writer applies its modification to the inactive replica, switches readers over to it, waits for the readers of the old replica to leave, and then applies the same modification to the old replica. Writers are serialised among each other. Unlike `RcuThreadSafe`, updates do not copy or allocate, but every modification is executed twice and the object takes twice the memory. Cannot be used with `multi_lock` or `range_lock`. */
+	class LeftRight
+	{
+		friend class LeftRightReadLock<T>;
+
+		/** The first replica. */
+		T m_left;
+		/** The second replica. */
+		T m_right;
+
+		/** The two read indicators, each split into per-thread-slot counters. */
+		mutable helper::ReaderShard m_readers[2][helper::reader_shards];
+		/** The read indicator new readers announce themselves on. */
+		alignas(helper::cache_line) std::atomic<unsigned> m_version;
+		/** The replica new readers read (0: left, 1: right). */
+		std::atomic<unsigned> m_active;
+		/** Serialises writers. */
+		std::mutex m_writer;
+
+	public:
+		template<class ...Args>
+		/** Creates both replicas with the given arguments.
+			The second replica is copied from the first.
+		@param[in] args:
+			The arguments used to construct the object. */
+		LeftRight(
+			Args&&... args);
+
+		LeftRight(
+			LeftRight<T> const&) = delete;
+		LeftRight<T> &operator=(
+			LeftRight<T> const&) = delete;
+
+		/** Acquires a read lock on the active replica.
+			Wait-free. */
+		LeftRightReadLock<T> read() const;
+
+		template<class Fn>
+		/** Applies a modification to both replicas.
+			Blocks until the readers of each replica have left before it is modified. Never blocks readers. `fn` is called once per replica, so it has to be deterministic and must leave both replicas equal.
+			If `fn` throws on the first replica, that replica is restored from the other one and the update has no effect. If it throws on the second replica, readers already see the modified first replica, so the second replica is restored from it and the update takes effect. Either way, the exception is rethrown and both replicas are equal afterwards. Restoring uses `T`'s copy assignment, which is only required if `fn` is not `noexcept`.
+		@param[in] fn:
+			Called with a `T &` to each replica in turn. */
+		void update(
+			Fn &&fn);
+
+	private:
+		/** Returns the given replica. */
+		inline T &replica(
+			unsigned index);
+		/** Returns the given replica. */
+		inline T const& replica(
+			unsigned index) const;
+		template<class Fn>
+		/** Applies a modification that cannot throw to a replica. */
+		void modify(
+			Fn &fn,
+			unsigned index,
+			std::true_type nothrow);
+		template<class Fn>
+		/** Applies a modification to a replica. Restores the replica from the other one if it throws. */
+		void modify(
+			Fn &fn,
+			unsigned index,
+			std::false_type nothrow);
+		/** Waits until all readers have left the given read indicator.
+		@param[in] version:
+			The read indicator to drain. */
+		void drain_readers(
+			unsigned version);
+	};
+
+	template<class T>
+	/** Scoped read lock on a `LeftRight` object.
+		Holding it delays writers, but never blocks other readers. */
+	class LeftRightReadLock
+	{
+		friend class LeftRight<T>;
+
+		/** The proxy this lock is bound to. */
+		LeftRight<T> const * m_proxy;
+		/** The replica this lock protects. */
+		T const * m_object;
+		/** The read indicator the lock was acquired on. */
+		unsigned m_version;
+		/** The read indicator shard the lock was acquired through. */
+		std::size_t m_shard;
+
+		LeftRightReadLock(
+			LeftRight<T> const& proxy);
+	public:
+		/** Creates an empty read lock. */
+		inline LeftRightReadLock();
+		/** Copies the read lock. */
+		LeftRightReadLock(
+			LeftRightReadLock<T> const& other);
+		/** Moves the lock ownership from `move`.
+		@param[in,out] move:
+			The read lock to move. */
+		LeftRightReadLock(
+			LeftRightReadLock<T> &&move);
+		/** Releases the read lock. */
+		~LeftRightReadLock();
+
+		/** Copies a read lock.
+			Unlocks `this` if it is not empty.
+		@param[in] other:
+			The lock to copy.
+		@return
+			A reference to `this`. */
+		LeftRightReadLock<T> &operator=(
+			LeftRightReadLock<T> const& other);
+		/** Moves a read lock.
+			Unlocks `this` if it is not empty.
+		@param[in,out] move:
+			The lock to move.
+		@return
+			A reference to `this`. */
+		LeftRightReadLock<T> &operator=(
+			LeftRightReadLock<T> &&move);
+
+		/** Accesses the locked replica. */
+		inline T const* operator->() const;
+		/** Accesses the locked replica. */
+		inline T const& operator*() const;
+		/** Returns whether the read lock is bound to any proxy. */
+		inline bool locked() const;
+		/** Same as `locked()`. */
+		inline operator bool() const;
+
+		/** Releases the lock.
+			The object must be locked. */
+		inline void unlock();
+
+	private:
+		/** Returns the counter this lock is announced on. */
+		inline std::atomic<std::uint32_t> &readers() const;
+	};
+}
+
+#include "LeftRight.inl"
+
+#endif
@@ -0,0 +1,232 @@
+namespace lock
+{
+	template<class T>
+	template<class ...Args>
+	LeftRight<T>::LeftRight(
+		Args&&... args):
+		m_left(std::forward<Args>(args)...),
+		m_right(m_left),
+		m_readers(),
+		m_version(0),
+		m_active(0),
+		m_writer()
+	{
+	}
+
+	template<class T>
+	LeftRightReadLock<T> LeftRight<T>::read() const
+	{
+		return LeftRightReadLock<T>(*this);
+	}
+
+	template<class T>
+	template<class Fn>
+	void LeftRight<T>::update(
+		Fn &&fn)
+	{
+		typedef std::integral_constant<bool, noexcept(fn(std::declval<T &>()))> nothrow;
+		std::lock_guard<std::mutex> lock(m_writer);
+
+		unsigned const active = m_active.load(std::memory_order_relaxed);
+		// nobody reads the inactive replica.
+		modify(fn, active ^ 1, nothrow());
+		m_active.store(active ^ 1, std::memory_order_seq_cst);
+
+		// toggle the read indicator, so that the readers of the old replica can drain without new ones arriving.
+		unsigned const version = m_version.load(std::memory_order_relaxed);
+		drain_readers(version ^ 1);
+		m_version.store(version ^ 1, std::memory_order_seq_cst);
+		drain_readers(version);
+
+		modify(fn, active, nothrow());
+	}
+
+	template<class T>
+	template<class Fn>
+	void LeftRight<T>::modify(
+		Fn &fn,
+		unsigned index,
+		std::true_type)
+	{
+		fn(replica(index));
+	}
+
+	template<class T>
+	template<class Fn>
+	void LeftRight<T>::modify(
+		Fn &fn,
+		unsigned index,
+		std::false_type)
+	{
+		static_assert(std::is_copy_assignable<T>::value,
+			"LeftRight::update() needs a noexcept modification, or a copy assignable object to restore a replica after an exception.");
+
+		try {
+			fn(replica(index));
+		} catch(...)
+		{
+			// nobody reads this replica, and the other one is consistent.
+			replica(index) = replica(index ^ 1);
+			throw;
+		}
+	}
+
+	template<class T>
+	T &LeftRight<T>::replica(
+		unsigned index)
+	{
+		return index ? m_right : m_left;
+	}
+
+	template<class T>
+	T const& LeftRight<T>::replica(
+		unsigned index) const
+	{
+		return index ? m_right : m_left;
+	}
+
+	template<class T>
+	void LeftRight<T>::drain_readers(
+		unsigned version)
+	{
+		for(auto const& shard : m_readers[version])
+			for(unsigned attempt = 0; shard.readers.load(std::memory_order_seq_cst); attempt++)
+				if(attempt < helper::spin_attempts)
+					helper::cpu_relax();
+				else
+					std::this_thread::yield();
+	}
+
+	template<class T>
+	LeftRightReadLock<T>::LeftRightReadLock(
+		LeftRight<T> const& proxy):
+		m_proxy(&proxy),
+		m_version(proxy.m_version.load(std::memory_order_seq_cst)),
+		m_shard(helper::reader_shard())
+	{
+		readers().fetch_add(1, std::memory_order_seq_cst);
+		m_object = &proxy.replica(proxy.m_active.load(std::memory_order_seq_cst));
+	}
+
+	template<class T>
+	LeftRightReadLock<T>::LeftRightReadLock():
+		m_proxy(nullptr),
+		m_object(nullptr),
+		m_version(0),
+		m_shard(0)
+	{
+	}
+
+	template<class T>
+	LeftRightReadLock<T>::LeftRightReadLock(
+		LeftRightReadLock<T> const& other):
+		m_proxy(other.m_proxy),
+		m_object(other.m_object),
+		m_version(other.m_version),
+		m_shard(other.m_shard)
+	{
+		if(m_proxy)
+			readers().fetch_add(1, std::memory_order_relaxed);
+	}
+
+	template<class T>
+	LeftRightReadLock<T>::LeftRightReadLock(
+		LeftRightReadLock<T> &&move):
+		m_proxy(move.m_proxy),
+		m_object(move.m_object),
+		m_version(move.m_version),
+		m_shard(move.m_shard)
+	{
+		move.m_proxy = nullptr;
+	}
+
+	template<class T>
+	LeftRightReadLock<T>::~LeftRightReadLock()
+	{
+		if(locked())
+			readers().fetch_sub(1, std::memory_order_seq_cst);
+	}
+
+	template<class T>
+	LeftRightReadLock<T> &LeftRightReadLock<T>::operator=(
+		LeftRightReadLock<T> const& other)
+	{
+		if(this == &other)
+			return *this;
+
+		if(other.m_proxy)
+			other.readers().fetch_add(1, std::memory_order_relaxed);
+		if(m_proxy)
+			readers().fetch_sub(1, std::memory_order_seq_cst);
+
+		m_proxy = other.m_proxy;
+		m_object = other.m_object;
+		m_version = other.m_version;
+		m_shard = other.m_shard;
+
+		return *this;
+	}
+
+	template<class T>
+	LeftRightReadLock<T> &LeftRightReadLock<T>::operator=(
+		LeftRightReadLock<T> &&move)
+	{
+		if(this == &move)
+			return *this;
+
+		if(m_proxy)
+			readers().fetch_sub(1, std::memory_order_seq_cst);
+
+		m_proxy = move.m_proxy;
+		m_object = move.m_object;
+		m_version = move.m_version;
+		m_shard = move.m_shard;
+		move.m_proxy = nullptr;
+
+		return *this;
+	}
+
+	template<class T>
+	T const * LeftRightReadLock<T>::operator->() const
+	{
+		assert(locked()
+			&& "Tried to access empty lock.");
+		return m_object;
+	}
+
+	template<class T>
+	T const& LeftRightReadLock<T>::operator*() const
+	{
+		assert(locked()
+			&& "Tried to access empty lock.");
+		return *m_object;
+	}
+
+	template<class T>
+	bool LeftRightReadLock<T>::locked() const
+	{
+		return m_proxy != nullptr;
+	}
+
+	template<class T>
+	LeftRightReadLock<T>::operator bool() const
+	{
+		return locked();
+	}
+
+	template<class T>
+	void LeftRightReadLock<T>::unlock()
+	{
+		assert(locked()
+			&& "Tried to unlock empty lock.");
+
+		readers().fetch_sub(1, std::memory_order_seq_cst);
+		m_proxy = nullptr;
+	}
+
+	template<class T>
+	std::atomic<std::uint32_t> &LeftRightReadLock<T>::readers() const
+	{
+		return m_proxy->m_readers[m_version][m_shard].readers;
+	}
+}
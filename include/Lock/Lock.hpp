@@ -6,26 +6,75 @@
 #include <cassert>
 #include <thread>
 #include <memory>
+#include <new>
 #include <atomic>
-#include <random>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <exception>
+#include <chrono>
+
+#ifdef LOCK_STATISTICS
+#include <unordered_map>
+#endif
 
 namespace lock
 {
-	template<class T>
+	/** Memory layout policies for thread safe objects. */
+	namespace layout
+	{
+		struct Compact;
+		struct Separated;
+		struct Padded;
+	}
+
+	/** Lock engines: the synchronisation primitives that thread safe objects are built on (see `lock::engine::LockWord` for the required interface).
+		The provided engines are `Futex`, `Spin` and `Queue`. `Atomic` is not a lock, but selects the lock-free specialization of `ThreadSafe`. There is no seqlock or sharded-reader engine: optimistic reads are built into `ThreadSafe` on top of every engine, and sharded readers are `ShardedThreadSafe`, as their read locks have to remember their shard, which the engine interface does not carry. */
+	namespace engine
+	{
+		/** The kind of lock a thread is waiting for. */
+		enum class Access
+		{
+			read,
+			write,
+			upgrade
+		};
+
+		template<bool Park>
+		class LockWord;
+
+		/** A single lock word; blocked threads spin briefly, then park on it (futex on Linux). The default. */
+		typedef LockWord<true> Futex;
+		/** A single lock word; blocked threads spin briefly, then yield, but never park. Avoids system calls for very short critical sections on dedicated cores. */
+		typedef LockWord<false> Spin;
+
+		class Queue;
+
+		/** Not a lock: selects the lock-free specialization of `ThreadSafe` for objects that fit a lock-free `std::atomic` (see `helper::fits_atomic`). */
+		struct Atomic;
+	}
+
+	template<class T, class Layout = layout::Compact, class Engine = engine::Futex>
 	class WriteLock;
-	template<class T>
+	template<class T, class Layout = layout::Compact, class Engine = engine::Futex>
 	class ReadLock;
-	template<class T>
+	template<class T, class Layout = layout::Compact, class Engine = engine::Futex>
+	class OptimisticReadLock;
+	template<class T, class Layout = layout::Compact, class Engine = engine::Futex>
+	class UpgradeLock;
+	template<class T, class Layout = layout::Compact, class Engine = engine::Futex>
 	class ThreadSafe;
 
-	template<class T>
+	template<class T, class Layout = layout::Compact, class Engine = engine::Futex>
 	/** Binds a read lock handle to a resource. */
 	struct ReadLockPair
 	{
 		/** The lock to lock `thread_safe`. */
-		ReadLock<T> &lock;
+		ReadLock<T, Layout, Engine> &lock;
 		/** The thread safe resource to be locked. */
-		ThreadSafe<T> &thread_safe;
+		ThreadSafe<T, Layout, Engine> &thread_safe;
 
 		/** Creates a read lock pair.
 		@param[in] lock:
@@ -33,18 +82,18 @@ namespace lock
 		@param[in] thread_safe:
 			The thread safe resource to be locked. */
 		ReadLockPair(
-			ReadLock<T> &lock,
-			ThreadSafe<T> &thread_safe);
+			ReadLock<T, Layout, Engine> &lock,
+			ThreadSafe<T, Layout, Engine> &thread_safe);
 	};
 
-	template<class T>
+	template<class T, class Layout = layout::Compact, class Engine = engine::Futex>
 	/** Binds a write lock handle to a resource. */
 	struct WriteLockPair
 	{
 		/** The lock to lock `thread_safe`. */
-		WriteLock<T> &lock;
+		WriteLock<T, Layout, Engine> &lock;
 		/** The thread safe resource to be locked. */
-		ThreadSafe<T> &thread_safe;
+		ThreadSafe<T, Layout, Engine> &thread_safe;
 
 		/** Creates a write lock pair.
 		@param[in] lock:
@@ -52,8 +101,8 @@ namespace lock
 		@param[in] thread_safe:
 			The thread safe resource to be locked. */
 		WriteLockPair(
-			WriteLock<T> &lock,
-			ThreadSafe<T> &thread_safe);
+			WriteLock<T, Layout, Engine> &lock,
+			ThreadSafe<T, Layout, Engine> &thread_safe);
 	};
 
 	/** Helper namespace with functions and data types that are only of internal use. */
@@ -67,6 +116,162 @@ namespace lock
 		struct bad_thread_safe_move { };
 		struct bad_thread_safe_destruct { };
 
+		/** Layout of the lock word of thread safe objects. */
+		namespace state
+		{
+			/** Set while the object is write locked. */
+			constexpr std::uint32_t write = std::uint32_t(1) << 31;
+			/** Set while threads are parked on the lock word. */
+			constexpr std::uint32_t waiters = std::uint32_t(1) << 30;
+			/** Set while the object is locked by an upgrade lock. */
+			constexpr std::uint32_t upgrade = std::uint32_t(1) << 29;
+			/** Set while readers are parked, waiting for the write lock to be released. */
+			constexpr std::uint32_t read_waiters = std::uint32_t(1) << 28;
+			/** Set while threads waiting for a write or upgrade lock may be parked. */
+			constexpr std::uint32_t write_waiters = std::uint32_t(1) << 27;
+			/** Mask of the read lock count. */
+			constexpr std::uint32_t readers = write_waiters - 1;
+		}
+
+		/** The assumed size of a cache line. */
+		constexpr std::size_t cache_line = 64;
+
+		template<class T>
+		/** Whether `T` can be kept in a lock-free `std::atomic<T>`: it is trivially copyable, and of a size that common platforms load, store and compare-and-swap natively. `ThreadSafe<T, Layout, engine::Atomic>` requires it. */
+		struct fits_atomic: std::integral_constant<bool,
+			std::is_trivially_copyable<T>::value
+			&& (sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8)>
+		{
+		};
+
+		template<class T>
+		/** Allocates and default constructs an array, honouring the alignment of over-aligned types.
+			Before C++17, `new T[]` ignores alignments above that of `std::max_align_t`, so cache line aligned elements could share cache lines.
+		@param[in] count:
+			The number of elements.
+		@return
+			The array, to be destroyed with `delete_aligned()`. */
+		T * new_aligned(
+			std::size_t count);
+
+		template<class T>
+		/** Destroys and frees an array allocated with `new_aligned()`.
+		@param[in] objects:
+			The array, or null.
+		@param[in] count:
+			The number of elements. */
+		void delete_aligned(
+			T * objects,
+			std::size_t count);
+
+		template<class T>
+		/** Deleter of arrays allocated with `new_aligned()`, for `std::unique_ptr`. */
+		struct AlignedDelete
+		{
+			/** The number of elements. */
+			std::size_t count;
+
+			void operator()(
+				T * objects) const;
+		};
+
+		/** How many times a blocked thread spins before it parks. */
+		constexpr unsigned spin_attempts = 8;
+
+		/** Hints the processor that the current thread is busy waiting. */
+		inline void cpu_relax();
+
+		/** Blocks the current thread while `word` equals `expected`.
+			May return spuriously.
+		@param[in] word:
+			The word to wait on.
+		@param[in] expected:
+			The value `word` is expected to have. */
+		inline void park(
+			std::atomic<std::uint32_t> &word,
+			std::uint32_t expected);
+
+		/** Wakes all threads parked on `word`.
+		@param[in] word:
+			The word the threads are parked on. */
+		inline void unpark_all(
+			std::atomic<std::uint32_t> &word);
+		/** Wakes one of the threads parked on `word`.
+		@param[in] word:
+			The word the threads are parked on. */
+		inline void unpark_one(
+			std::atomic<std::uint32_t> &word);
+
+		/** Returns a unique, non-zero token identifying the current thread. */
+		inline std::uint32_t thread_token();
+
+		/** The number of publication slots of a thread safe object's combiner. Must be a power of two. */
+		constexpr std::size_t combiner_slots = 32;
+
+		template<class T>
+		/** A closure published to a thread safe object's combiner. */
+		struct CombinerRequest
+		{
+			/** Executes the closure on the object. Must not throw. */
+			void (*execute)(
+				CombinerRequest<T> &request,
+				T &object);
+			/** Set once the closure was executed. */
+			std::atomic<bool> done;
+			/** The exception the closure threw, if any. */
+			std::exception_ptr error;
+
+			inline CombinerRequest(
+				void (*execute)(CombinerRequest<T> &, T &));
+		};
+
+		template<class T, class Fn, class R>
+		/** A combiner request that calls `Fn` and stores its result. */
+		struct CombinerCall : CombinerRequest<T>
+		{
+			static_assert(!std::is_reference<R>::value,
+				"ThreadSafe::apply() must not return references into the object.");
+
+			/** The closure to call. */
+			Fn &fn;
+			/** The closure's result, once it was executed successfully. */
+			typename std::aligned_storage<sizeof(R), alignof(R)>::type value;
+
+			CombinerCall(
+				Fn &fn);
+			~CombinerCall();
+
+			static void execute(
+				CombinerRequest<T> &request,
+				T &object);
+			/** Returns the result, or rethrows the closure's exception. */
+			R result();
+		};
+
+		template<class T, class Fn>
+		struct CombinerCall<T, Fn, void> : CombinerRequest<T>
+		{
+			Fn &fn;
+
+			CombinerCall(
+				Fn &fn);
+
+			static void execute(
+				CombinerRequest<T> &request,
+				T &object);
+			void result();
+		};
+
+		template<class T>
+		/** A publication slot of a combiner, occupying its own cache line. */
+		struct alignas(cache_line) CombinerSlot
+		{
+			/** The published request, if any. */
+			std::atomic<CombinerRequest<T> *> request;
+
+			CombinerSlot();
+		};
+
 		template<class ... Types>
 		struct each_exists {};
 
@@ -79,15 +284,15 @@ namespace lock
 
 		template<class T>
 		struct is_lock_pair { };
-		template<class T>
-		struct is_lock_pair<WriteLockPair<T>>
+		template<class T, class Layout, class Engine>
+		struct is_lock_pair<WriteLockPair<T, Layout, Engine>>
 		{
-			typedef WriteLockPair<T> type;
+			typedef WriteLockPair<T, Layout, Engine> type;
 		};
-		template<class T>
-		struct is_lock_pair<ReadLockPair<T>>
+		template<class T, class Layout, class Engine>
+		struct is_lock_pair<ReadLockPair<T, Layout, Engine>>
 		{
-			typedef ReadLockPair<T> type;
+			typedef ReadLockPair<T, Layout, Engine> type;
 		};
 
 		template<class ...T>
@@ -101,6 +306,283 @@ namespace lock
 		{
 			typedef typename each_lock_pair<typename std::iterator_traits<T>::value_type...>::type type;
 		};
+
+		/** Grants access to the objects of thread safe children that are covered by a lock on their parent (see `Hierarchy.hpp`). */
+		struct Unguarded;
+
+		/** A type-erased blocking acquisition of a lock pair, used by the ordered locking functions. */
+		struct Acquisition
+		{
+			/** The ordering key of the resource (its address). */
+			void const * key;
+			/** The lock pair to acquire. */
+			void * pair;
+			/** Acquires `pair`, blocking and ignoring reservations. */
+			void (*acquire)(void * pair);
+
+			template<class T, class Layout, class Engine>
+			/** Creates an acquisition of a read lock pair. */
+			Acquisition(
+				ReadLockPair<T, Layout, Engine> &pair);
+			template<class T, class Layout, class Engine>
+			/** Creates an acquisition of a write lock pair. */
+			Acquisition(
+				WriteLockPair<T, Layout, Engine> &pair);
+
+			/** Orders acquisitions by their resource's key. */
+			inline bool operator<(
+				Acquisition const& other) const;
+
+			template<class T, class Layout, class Engine>
+			static void acquire_read(
+				void * pair);
+			template<class T, class Layout, class Engine>
+			static void acquire_write(
+				void * pair);
+		};
+	}
+
+	namespace layout
+	{
+		/** Stores the lock state directly after the object, without any padding.
+			The smallest layout, and the default. Neighbouring objects (e.g., in an array) share cache lines with the lock state, so acquiring one object's lock slows down threads accessing its neighbours (false sharing). */
+		struct Compact
+		{
+			/** The minimum alignment of the protected object. */
+			static constexpr std::size_t object_alignment = 1;
+			/** The minimum alignment of the lock state. */
+			static constexpr std::size_t metadata_alignment = 1;
+			/** The minimum alignment of the version polled by optimistic readers. */
+			static constexpr std::size_t version_alignment = 1;
+		};
+
+		/** Places the object, the lock state and the version on separate cache lines.
+			Lock traffic no longer invalidates the cache line holding the object, and vice versa. The version, which optimistic readers poll, only changes when a write lock is acquired or released, so it gets its own cache line too: contended lock attempts, reservations and read locks do not invalidate it under the optimistic readers. Use this for objects that are read through optimistic reads, or accessed heavily while other threads contend for the lock. Takes at least three cache lines per object. */
+		struct Separated
+		{
+			static constexpr std::size_t object_alignment = helper::cache_line;
+			static constexpr std::size_t metadata_alignment = helper::cache_line;
+			static constexpr std::size_t version_alignment = helper::cache_line;
+		};
+
+		/** Aligns the whole thread safe object to a cache line, and pads it to a multiple of the cache line size.
+			The object and its lock state share a cache line, but no two thread safe objects do. Use this for arrays and vectors of thread safe objects that are locked independently, e.g., through `range_lock()`. */
+		struct Padded
+		{
+			static constexpr std::size_t object_alignment = helper::cache_line;
+			static constexpr std::size_t metadata_alignment = 1;
+			static constexpr std::size_t version_alignment = 1;
+		};
+	}
+
+	namespace engine
+	{
+		template<bool Park>
+		/** A reader-writer lock in a single 32 bit word: the write lock bit, the upgrade lock bit, the waiter bits and the read lock count (see `helper::state`).
+			Blocked readers and blocked writers park on two separate words, so that a release only wakes threads it can admit: releasing a write lock wakes all parked readers and one thread waiting for a write or upgrade lock, the last reader and the upgrade lock wake one such thread, and `downgrade()` wakes the parked readers. Only a thread in `upgrade()` parks on the lock word itself. Takes 12 bytes.
+			Also documents the interface every engine must provide. A thread safe object calls the engine only while it holds the matching lock, and handles reservations, statistics, the version and the combiner itself, so engines only decide who holds the lock and how blocked threads wait. `try_upgrade()`, `lock_upgrade()`, `upgrade()` and `downgrade()` are only needed for upgrade locks and `WriteLock::downgrade()`.
+		@tparam Park:
+			Whether blocked threads park on the lock word after spinning, or keep yielding. */
+		class LockWord
+		{
+			/** The lock word. */
+			std::atomic<std::uint32_t> m_state;
+			/** Parked readers wait on this. Incremented whenever they are woken. */
+			std::atomic<std::uint32_t> m_read_wakeups;
+			/** Threads waiting for a write or upgrade lock park on this. Incremented whenever one of them is woken. */
+			std::atomic<std::uint32_t> m_write_wakeups;
+
+			/** Wakes all parked readers. */
+			inline void wake_readers();
+			/** Wakes one of the threads waiting for a write or upgrade lock. */
+			inline void wake_writer();
+			/** Returns the lock word bits that block a thread asking for `access`. */
+			static inline std::uint32_t blocking(
+				Access access);
+
+		public:
+			inline LockWord();
+
+			LockWord(
+				LockWord const&) = delete;
+			LockWord &operator=(
+				LockWord const&) = delete;
+
+			/** Tries to acquire a write lock. Never blocks. */
+			inline bool try_write();
+			/** Tries to acquire a read lock. Never blocks. */
+			inline bool try_read();
+			/** Tries to acquire the upgrade lock, which coexists with read locks. Never blocks. */
+			inline bool try_upgrade();
+
+			template<class Claim>
+			/** Blocks until a write lock is acquired, or until `claim` fails.
+			@param[in] claim:
+				Called before every attempt, returns whether the caller may take the lock right now. Once it returns false (e.g., the object is reserved for another thread), the engine stops waiting and returns, so that the caller can wait for whatever the engine cannot see, and call again. A wakeup the caller consumed is passed on first (see `abandon()`).
+			@return
+				Whether the lock was acquired. */
+			bool lock_write(
+				Claim &&claim);
+			template<class Claim>
+			/** Blocks until a read lock is acquired, or until `claim` fails (see `lock_write()`). */
+			bool lock_read(
+				Claim &&claim);
+			template<class Claim>
+			/** Blocks until the upgrade lock is acquired, or until `claim` fails (see `lock_write()`). */
+			bool lock_upgrade(
+				Claim &&claim);
+
+			/** Adds a read lock to an already read locked engine. */
+			inline void add_read();
+			/** Releases a write lock, and wakes the parked readers and one parked writer. */
+			inline void unlock_write();
+			/** Releases a read lock, and wakes a parked writer (or the thread in `upgrade()`) if it was the last one. */
+			inline void unlock_read();
+			/** Releases the upgrade lock and wakes one parked writer. */
+			inline void unlock_upgrade();
+			/** Turns the held upgrade lock into a write lock.
+				Blocks new readers, and waits until the remaining readers have left. */
+			void upgrade();
+			/** Turns the held write lock into a read lock, without unlocking in between, and wakes the parked readers. */
+			inline void downgrade();
+
+			/** Returns whether any lock is held. Only for checks while no thread can lock concurrently. */
+			inline bool locked() const;
+			/** Returns whether the lock currently blocks a thread asking for `access`. Not part of the engine interface; `Queue` uses it. */
+			inline bool blocks(
+				Access access) const;
+
+			/** Waits after a failed `try_*()` call.
+				Spins for the first few attempts, then parks the current thread until a release wakes it (or yields, if `Park` is false or the lock is not what blocked the caller).
+			@param[in] attempt:
+				The number of failed attempts so far.
+			@param[in] access:
+				The kind of lock the caller tried to acquire. */
+			void wait(
+				unsigned attempt,
+				Access access);
+			/** Stops waiting after `wait()` without acquiring the lock.
+				A release wakes only one of the threads waiting for a write or upgrade lock. If that thread does not take the lock (e.g., because its combined call is already done), it passes the wakeup on to another one here.
+			@param[in] access:
+				The kind of lock the caller waited for. */
+			inline void abandon(
+				Access access);
+		};
+
+		/** A queue lock (MCS) in front of a `Futex` lock word, for locks with many blocked threads.
+			Threads that block in `lock_*()` or `wait()` line up in a queue of nodes on their own stacks, each on its own cache line. All but the head of the queue spin, and then park, on their own node, until their predecessor hands the head position to them directly. The head registers itself with the queue and parks on its node as well: the thread releasing the lock acquires it on the head's behalf and wakes only the head, which then holds the lock without competing for it. The cost of a handoff thus does not grow with the number of waiters, and a releasing thread cannot take the lock straight back while another thread waits for it. Consecutive readers at the head enter together: a reader passes the head position on as soon as it holds its read lock.
+			Queued threads are served strictly in order, even where the current holder would admit a thread further back: a reader queued behind a waiting writer or upgrader waits for it, so that queued writers cannot be starved by a stream of readers. `try_*()` calls do not queue and may still overtake queued threads, like with `LockWord`. Takes 32 bytes instead of 12. */
+		class Queue
+		{
+			/** A blocked thread's place in the queue. */
+			struct alignas(helper::cache_line) Node
+			{
+				/** The node's thread waits behind its predecessor, or for the lock to be handed over. */
+				static constexpr std::uint32_t waiting = 0;
+				/** The node's thread is parked on `state`. */
+				static constexpr std::uint32_t parked = 1;
+				/** The node is at the head of the queue. */
+				static constexpr std::uint32_t head = 2;
+				/** The lock was handed over to the node's thread. */
+				static constexpr std::uint32_t granted = 3;
+
+				/** The node queued after this one, once it linked itself in. */
+				std::atomic<Node *> next;
+				/** `waiting`, `parked`, `head` or `granted`. */
+				std::atomic<std::uint32_t> state;
+				/** The kind of lock the node's thread waits for at the head of the queue. */
+				Access access;
+				/** Whether the lock is acquired on behalf of the node's thread, or the thread is only woken once it could acquire it (in `wait()`). */
+				bool acquire;
+
+				inline Node();
+
+				/** Blocks until `state` is `until`.
+				@param[in] until:
+					`head` or `granted`. */
+				inline void await(
+					std::uint32_t until);
+				/** Sets `state` and wakes the node's thread.
+				@param[in] state:
+					`head` or `granted`. */
+				inline void signal(
+					std::uint32_t state);
+			};
+
+			/** The lock word. Only a thread in `upgrade()` parks on it: the head of the queue parks on its node. */
+			LockWord<true> m_word;
+			/** The last node in the queue, or null if no thread is queued. */
+			std::atomic<Node *> m_tail;
+			/** The head of the queue while it waits for the lock to be handed over, or null. */
+			std::atomic<Node *> m_head;
+
+			template<class Acquire>
+			/** Queues the current thread, calls `acquire()` with its node once it is at the head of the queue, and passes the head position on.
+			@return
+				What `acquire()` returned. */
+			bool queued(
+				Acquire &&acquire);
+			template<class Claim>
+			/** Acquires the lock at the head of the queue, or fails once `claim` fails (see `LockWord::lock_write()`). */
+			bool acquire_at_head(
+				Node &head,
+				Access access,
+				Claim &claim);
+			/** Tries to acquire the given kind of lock. */
+			inline bool try_lock(
+				Access access);
+			/** Releases the given kind of lock. */
+			inline void unlock(
+				Access access);
+			/** Registers the head of the queue for a handoff, and parks it until the lock is handed over.
+			@param[in] head:
+				The current thread's node, at the head of the queue.
+			@return
+				Whether the lock was handed over. False if the lock was released before the registration, in which case the head is registered no more and tries again itself. */
+			inline bool await_handover(
+				Node &head);
+			/** Called after every release: hands the lock over to the registered head of the queue, if the lock admits it now. */
+			inline void hand_over();
+
+		public:
+			inline Queue();
+
+			Queue(
+				Queue const&) = delete;
+			Queue &operator=(
+				Queue const&) = delete;
+
+			inline bool try_write();
+			inline bool try_read();
+			inline bool try_upgrade();
+
+			template<class Claim>
+			bool lock_write(
+				Claim &&claim);
+			template<class Claim>
+			bool lock_read(
+				Claim &&claim);
+			template<class Claim>
+			bool lock_upgrade(
+				Claim &&claim);
+
+			inline void add_read();
+			inline void unlock_write();
+			inline void unlock_read();
+			inline void unlock_upgrade();
+			inline void upgrade();
+			inline void downgrade();
+
+			inline bool locked() const;
+
+			/** Spins for the first few attempts, then waits in the queue until the lock admits `access`, without acquiring it. */
+			inline void wait(
+				unsigned attempt,
+				Access access);
+			/** Does nothing: `wait()` returns only at the head of the queue and passes the head position on, so the caller holds no wakeup another thread needs. */
+			inline void abandon(
+				Access access);
+		};
 	}
 
 	template<class T>
@@ -128,7 +610,7 @@ namespace lock
 		inline T const& end() const;
 	};
 
-	template<class T>
+	template<class T, class Layout, class Engine>
 	/** Use this function to pass a (`ReadLock`, `ThreadSafe`) pair to the locking functions `lock::multi_lock` and `lock::multi_read_lock`.
 	@param[in] lock:
 		The lock to lock `thread_safe`.
@@ -136,11 +618,11 @@ namespace lock
 		The thread safe resource to be locked.
 	@return
 		The pair (`lock`, `thread_safe`). */
-	inline ReadLockPair<T> pair(
-		ReadLock<T> &lock,
-		ThreadSafe<T> &thread_safe);
+	inline ReadLockPair<T, Layout, Engine> pair(
+		ReadLock<T, Layout, Engine> &lock,
+		ThreadSafe<T, Layout, Engine> &thread_safe);
 
-	template<class T>
+	template<class T, class Layout, class Engine>
 	/** Use this function to pass a (`WriteLock`, `ThreadSafe`) pair to the locking functions `lock::multi_lock` and `lock::multi_write_lock`.
 	@param[in] lock:
 		The lock to lock `thread_safe`.
@@ -148,9 +630,9 @@ namespace lock
 		The thread safe resource to be locked.
 	@return
 		The pair (`lock`, `thread_safe`). */
-	inline WriteLockPair<T> pair(
-		WriteLock<T> &lock,
-		ThreadSafe<T> &thread_safe);
+	inline WriteLockPair<T, Layout, Engine> pair(
+		WriteLock<T, Layout, Engine> &lock,
+		ThreadSafe<T, Layout, Engine> &thread_safe);
 
 	template<class T, class = typename helper::each_lock_pair_iterator<T>::type>
 	/** Creates a range denoted by a begin and end iterator.
@@ -164,25 +646,25 @@ namespace lock
 		T begin,
 		T end);
 
-	template<class T>
+	template<class T, class Layout, class Engine>
 	/** Use this function to acquire a write lock object for the given thread safe resource.
 		This function will block the current thread until a lock could be acquired.
 	@param[in,out] thread_safe:
 		The thread safe resource to lock.
 	@return
 		A write lock handle to the thread safe resource. */
-	inline WriteLock<T> write_lock(
-		ThreadSafe<T> &thread_safe);
+	inline WriteLock<T, Layout, Engine> write_lock(
+		ThreadSafe<T, Layout, Engine> &thread_safe);
 
-	template<class T>
+	template<class T, class Layout, class Engine>
 	/** Use this function to acquire a read lock object for the given thread safe resource.
 		This function will block the current thread until a lock could be acquired.
 	@param[in,out] thread_safe:
 		The thread safe resource to lock.
 	@return
 		A read lock handle to the thread safe resource. */
-	inline ReadLock<T> read_lock(
-		ThreadSafe<T> &thread_safe);
+	inline ReadLock<T, Layout, Engine> read_lock(
+		ThreadSafe<T, Layout, Engine> &thread_safe);
 
 
 	template<class ...InputIterator,
@@ -204,51 +686,377 @@ namespace lock
 	inline void multi_lock(
 		T&&... pairs);
 
-	template<class ...T>
+	template<class ...T, class ...Layout, class ...Engine>
 	/** Locks multiple thread safe objects for reading.
 		This function releases all locks and tries to re-lock all locks in case one or more resources could not be locked, to prevent dead locks, and retries. Note: If you have to read lock as well as write lock objects for a function / operation, use lock::multi_lock instead.
 	@param[in] pairs:
 		The resource and read lock pairs to lock. These can be acquired using the `lock::pair()` function. */
 	inline void multi_read_lock(
-		ReadLockPair<T>... pairs);
+		ReadLockPair<T, Layout, Engine>... pairs);
 
-	template<class ...T>
+	template<class ...T, class ...Layout, class ...Engine>
 	/** Locks multiple thread safe objects for writing.
 		This function releases all locks and tries to re-lock all locks in case one or more resources could not be locked, to prevent dead locks, and retries. Note: If you have to read lock as well as write lock objects for a function / operation, use lock::multi_lock instead.
 	@param[in] pairs:
 		The resource and write_lock pairs to lock. These can be acquired using the `lock::pair()` function. */
 	inline void multi_write_lock(
-		WriteLockPair<T>... pairs);
+		WriteLockPair<T, Layout, Engine>... pairs);
 
-	/** Tickets used to reserve a thread safe resource. */
-	typedef std::uint16_t ticket_t;
+	template<class ...T>
+	/** Locks multiple thread safe objects for writing or reading, in a global order.
+		Instead of trying and retrying, this function sorts the pairs by the address of their resource and acquires them one after another, blocking on each. As every ordered locking call acquires resources in the same order, this cannot dead lock, and no partial acquisitions are ever wasted. Reservations are ignored, so that ordered locking cannot dead lock with `lock::multi_lock()` or `lock::range_lock()` either. A resource must not appear more than once.
+	@param[in,out] pairs:
+		A mix of resource and read / write lock pairs to lock. These can be acquired using the `lock::pair()` function. */
+	inline void ordered_multi_lock(
+		T&&... pairs);
+
+	template<class ...InputIterator,
+		class = typename helper::each_lock_pair_iterator<InputIterator...>::type>
+	/** Locks ranges of lock pairs in a global order.
+		Same as `lock::ordered_multi_lock()`, for ranges. Allocates a buffer for sorting.
+	@tparam InputIterator:
+		Must be an iterator type over either ReadLockPair or WriteLockPair.
+	@param[in] ranges:
+		The ranges of lock pairs to lock. */
+	inline void ordered_range_lock(
+		Range<InputIterator>... ranges);
 
+	/** Tickets used to reserve a thread safe resource.
+		Tickets are drawn from a global monotonic counter once an acquisition's first attempt failed, and are kept until it succeeds. Lower tickets belong to older acquisitions and win reservation contests (wait-die): the oldest acquisition keeps its reservations, younger ones back off and retry. Zero is not a valid ticket. */
+	typedef std::uint64_t ticket_t;
 
-	template<class T>
+	namespace helper
+	{
+		/** Draws a new ticket. */
+		inline ticket_t next_ticket();
+		/** Returns the ticket of the current thread's ongoing acquisition, or zero if there is none. */
+		inline ticket_t &current_ticket();
+
+		/** Draws a ticket and makes it the current thread's ticket for the lifetime of the scope. */
+		class TicketScope
+		{
+			/** The ticket that was current before. */
+			ticket_t m_previous;
+			/** The drawn ticket. */
+			ticket_t m_ticket;
+		public:
+			inline TicketScope();
+			inline ~TicketScope();
+
+			TicketScope(
+				TicketScope const&) = delete;
+			TicketScope &operator=(
+				TicketScope const&) = delete;
+
+			/** Returns the drawn ticket. */
+			inline ticket_t ticket() const;
+		};
+	}
+
+	/** Contention statistics of a single thread safe object.
+		Only recorded if `LOCK_STATISTICS` is defined (in every translation unit). */
+	struct ContentionStatistics
+	{
+		/** The address of the thread safe object. Null for the objects that did not fit into the statistics buffers. */
+		void const * object;
+		/** How many times the object was locked. */
+		std::uint64_t acquisitions;
+		/** How many of the acquisitions could not lock the object immediately. */
+		std::uint64_t contended;
+		/** How many spin iterations blocked threads made. */
+		std::uint64_t spins;
+		/** How many times blocked threads yielded or parked. */
+		std::uint64_t parks;
+		/** The total time blocked threads waited for the object, in nanoseconds. */
+		std::uint64_t wait_time;
+		/** The total time the object was locked, in nanoseconds. Overlapping read locks count once. */
+		std::uint64_t hold_time;
+	};
+
+	/** Statistics of the `multi_lock()` / `range_lock()` calls of one call site with one lock set size.
+		Only recorded if `LOCK_STATISTICS` is defined (in every translation unit). */
+	struct MultiLockStatistics
+	{
+		/** The number of histogram buckets. Bucket `i > 0` counts values in `[2^(i-1), 2^i)`, bucket 0 counts zeroes, the last bucket also counts all larger values. */
+		static constexpr std::size_t buckets = 32;
+
+		/** The call site's name (see `CallSite`), or null for unnamed call sites. */
+		char const * site;
+		/** The number of resources locked per call. */
+		std::size_t size;
+		/** The number of calls. */
+		std::uint64_t calls;
+		/** The total number of reservation rounds (retries) of all calls. */
+		std::uint64_t retries;
+		/** How many times a call held a resource's reservation after reserving it. */
+		std::uint64_t reservation_wins;
+		/** How many times a call found a resource reserved by an older call after reserving it. */
+		std::uint64_t reservation_losses;
+		/** Histogram of the number of retries per call. */
+		std::uint64_t retry_histogram[buckets];
+		/** Histogram of the time per call until all resources were locked, in nanoseconds. */
+		std::uint64_t time_histogram[buckets];
+
+		/** Returns an upper bound of a percentile of the retries per call.
+		@param[in] percentile:
+			The percentile, between 0 and 1. */
+		inline std::uint64_t retry_percentile(
+			double percentile) const;
+		/** Returns an upper bound of a percentile of the time per call, in nanoseconds.
+		@param[in] percentile:
+			The percentile, between 0 and 1. */
+		inline std::uint64_t time_percentile(
+			double percentile) const;
+	};
+
+	namespace helper
+	{
+		/** Returns an upper bound of a percentile of a histogram (see `MultiLockStatistics`). */
+		inline std::uint64_t histogram_percentile(
+			std::uint64_t const (&histogram)[MultiLockStatistics::buckets],
+			double percentile);
+	}
+
+	/** Names the `multi_lock()` / `range_lock()` calls the current thread makes within the scope, for their statistics.
+		Does nothing unless `LOCK_STATISTICS` is defined. */
+	class CallSite
+	{
+#ifdef LOCK_STATISTICS
+		/** The previous name. */
+		char const * m_previous;
+#endif
+	public:
+		/** Names the call site.
+		@param[in] name:
+			The name, must outlive the statistics. */
+		explicit inline CallSite(
+			char const * name);
+		inline ~CallSite();
+
+		CallSite(
+			CallSite const&) = delete;
+		CallSite &operator=(
+			CallSite const&) = delete;
+	};
+
+#ifdef LOCK_STATISTICS
+	/** Returns the statistics of all `multi_lock()` / `range_lock()` call sites and lock set sizes.
+		Merges the per-thread statistics buffers without stopping the threads that record into them.
+	@return
+		The statistics, ordered by descending total retries. */
+	inline std::vector<MultiLockStatistics> multi_lock_snapshot();
+
+	/** Returns the statistics of the most contended thread safe objects.
+		Merges the per-thread statistics buffers without stopping the threads that record into them, so the result may be slightly out of date. Objects are identified by their address, so an object created at the address of a destroyed one continues its statistics.
+	@param[in] count:
+		The maximum number of objects to return.
+	@return
+		The statistics, ordered by descending total wait time. */
+	inline std::vector<ContentionStatistics> contention_snapshot(
+		std::size_t count);
+#endif
+
+	namespace helper
+	{
+		/** Hooks recording contention statistics into per-thread buffers.
+			They compile to nothing unless `LOCK_STATISTICS` is defined. */
+		namespace statistics
+		{
+			/** A point in time, in nanoseconds. */
+			typedef std::uint64_t timestamp_t;
+
+#ifdef LOCK_STATISTICS
+			/** The counters of an object's statistics. */
+			enum Counter
+			{
+				acquisitions,
+				contended_acquisitions,
+				spins,
+				parks,
+				wait_time,
+				hold_time,
+				counter_count
+			};
+
+			/** The number of objects a statistics buffer can hold. Must be a power of two. */
+			constexpr std::size_t buffer_entries = 1024;
+			/** How many entries are probed for an object before it is recorded as overflow. */
+			constexpr std::size_t buffer_probes = 16;
+
+			/** The statistics of a single object within a buffer. */
+			struct Entry
+			{
+				/** The object, or null if the entry is unused. */
+				std::atomic<void const *> object;
+				/** Written only by the buffer's owner, read by snapshots. */
+				std::atomic<std::uint64_t> counters[counter_count];
+
+				inline Entry();
+			};
+
+			/** The number of call site and lock set size combinations a statistics buffer can hold. Must be a power of two. */
+			constexpr std::size_t multi_lock_entries = 64;
+
+			/** The statistics of a call site with a lock set size within a buffer. */
+			struct MultiLockEntry
+			{
+				/** Whether the entry is used. Set after `site` and `size`. */
+				std::atomic<bool> used;
+				/** The call site. */
+				std::atomic<char const *> site;
+				/** The lock set size. */
+				std::atomic<std::size_t> size;
+				/** Written only by the buffer's owner, read by snapshots. */
+				std::atomic<std::uint64_t> calls, retries, wins, losses;
+				std::atomic<std::uint64_t> retry_histogram[MultiLockStatistics::buckets];
+				std::atomic<std::uint64_t> time_histogram[MultiLockStatistics::buckets];
+
+				inline MultiLockEntry();
+			};
+
+			/** A thread's statistics buffer.
+				Kept after the thread exited, and reused by later threads. */
+			struct Buffer
+			{
+				/** The statistics of the recorded objects, an open addressing hash table. */
+				Entry entries[buffer_entries];
+				/** The statistics of the objects that did not fit into `entries`. */
+				Entry overflow;
+				/** The statistics of the multi lock calls, an open addressing hash table. */
+				MultiLockEntry multi_locks[multi_lock_entries];
+				/** The statistics of the multi lock calls that did not fit into `multi_locks`. */
+				MultiLockEntry multi_lock_overflow;
+				/** Whether the buffer is owned by a thread. */
+				std::atomic<bool> used;
+				/** The next buffer in the registry. */
+				Buffer * next;
+
+				inline Buffer();
+			};
+
+			/** The registry of all statistics buffers. */
+			inline std::atomic<Buffer *> &buffers();
+			/** Returns the current thread's statistics buffer. */
+			inline Buffer &buffer();
+			/** Adds to a counter of an object in the current thread's buffer. */
+			inline void add(
+				void const * object,
+				Counter counter,
+				std::uint64_t amount);
+			/** Returns the current thread's call site name. */
+			inline char const * &call_site();
+			/** Returns the histogram bucket of a value. */
+			inline std::size_t bucket(
+				std::uint64_t value);
+			/** Adds to a counter that only the current thread writes. */
+			inline void increase(
+				std::atomic<std::uint64_t> &counter,
+				std::uint64_t amount);
+#endif
+
+			template<class ...InputIterator>
+			/** Returns the number of resources in the given ranges, or zero if statistics are disabled. */
+			std::size_t range_size(
+				Range<InputIterator>... ranges);
+
+			/** Records the statistics of a `multi_lock()` / `range_lock()` call. */
+			class MultiLockProbe
+			{
+#ifdef LOCK_STATISTICS
+				/** The number of resources to lock. */
+				std::size_t m_size;
+				/** When the call started. */
+				timestamp_t m_start;
+				/** The number of reservation rounds so far. */
+				std::uint64_t m_retries;
+				/** The won and lost reservations so far. */
+				std::uint64_t m_wins, m_losses;
+#endif
+			public:
+				/** Starts recording a call.
+				@param[in] size:
+					The number of resources to lock. */
+				explicit inline MultiLockProbe(
+					std::size_t size);
+
+				/** Records a reservation round.
+				@param[in] wins:
+					How many of the resources are reserved for the call. */
+				inline void reserved(
+					std::size_t wins);
+				/** Records that all resources were locked. */
+				inline void acquired();
+			};
+
+			/** Returns the current time, or zero if statistics are disabled. */
+			inline timestamp_t now();
+			/** Records that an object was locked. */
+			inline void acquired(
+				void const * object);
+			/** Records a failed locking attempt.
+			@param[in] attempt:
+				The number of failed attempts so far. */
+			inline void waited(
+				void const * object,
+				unsigned attempt);
+			/** Records that a blocked thread locked an object.
+			@param[in] since:
+				When the thread started waiting. */
+			inline void contended(
+				void const * object,
+				timestamp_t since);
+			/** Records that an object was unlocked.
+			@param[in] since:
+				When the object was locked. */
+			inline void held(
+				void const * object,
+				timestamp_t since);
+		}
+	}
+
+
+	template<class T, class Layout, class Engine>
 	/** Wrapper class for shared resources.
-		Use in combination with ReadLock and WriteLock, as well as the multi_lock function to ensure thread safety and prevent dead locks. To be explicit about only read locking / write locking, use multi_read_lock and multi_write_lock. A function / operation should ony have one lock call to acquire its locks. This prevents dead locks / incomplete locking of needed resources. Note that only one write lock may be attached to every shared resource at a time. A shared resource can be read locked multiple times at once. The shared resource is unlocked only after all read locks are released. While a shared resource is write locked, it can not be read locked. While a shared resource is read locked, it cannot be write locked. */
+		Use in combination with ReadLock and WriteLock, as well as the multi_lock function to ensure thread safety and prevent dead locks. To be explicit about only read locking / write locking, use multi_read_lock and multi_write_lock. A function / operation should ony have one lock call to acquire its locks. This prevents dead locks / incomplete locking of needed resources. Note that only one write lock may be attached to every shared resource at a time. A shared resource can be read locked multiple times at once. The shared resource is unlocked only after all read locks are released. While a shared resource is write locked, it can not be read locked. While a shared resource is read locked, it cannot be write locked.
+	@tparam Layout:
+		The memory layout policy (see `lock::layout`). Controls whether the object and its lock state share cache lines with each other and with neighbouring objects.
+	@tparam Engine:
+		The lock engine (see `lock::engine`). Decides how the lock is acquired and how blocked threads wait. Reservations, optimistic reads, flat combining and all locking functions work the same on every engine. */
 	class ThreadSafe
 	{
-		friend class WriteLock<T>;
-		friend class ReadLock<T>;
+		friend class WriteLock<T, Layout, Engine>;
+		friend class ReadLock<T, Layout, Engine>;
+		friend class OptimisticReadLock<T, Layout, Engine>;
+		friend class UpgradeLock<T, Layout, Engine>;
+		friend struct helper::Acquisition;
+		friend struct helper::Unguarded;
 
 		static struct Authorised { } const authorised;
 
 		/** The thread safe object. */
-		T m_object;
+		alignas(T) alignas(Layout::object_alignment) T m_object;
 
-		/** The mutex that protects the object. */
-		std::mutex m_mutex;
+		/** The lock engine. */
+		alignas(Engine) alignas(Layout::metadata_alignment) Engine m_engine;
 
-		/** Whether the thread safe object is write locked. */
-		bool m_write_lock;
-		/** The current read lock count. */
-		std::atomic<std::size_t> m_read_locks;
+		/** The ticket of the acquisition the thread safe object is reserved for, or zero if it is not reserved. */
+		std::atomic<ticket_t> m_reservation;
+		/** Threads that may not claim the object because of another thread's reservation park on this. The lowest bit is set while any are parked, the others count how often they were woken. */
+		std::atomic<std::uint32_t> m_reservation_wakeups;
 
-		/** The ticket with the highest priority. */
-		ticket_t m_priority;
-		/** Whether and, if, by whom, the thread safe object is reserved for ownership. */
-		std::thread::id m_reserved_by;
+#ifdef LOCK_STATISTICS
+		/** When the object was write locked, or read locked by the first of the current readers. */
+		std::atomic<helper::statistics::timestamp_t> m_locked_since;
+		/** The number of read locks, to find the first and last reader of a hold period. */
+		std::atomic<std::uint32_t> m_readers;
+#endif
+
+		/** The sequence number of the object's value.
+			Incremented when a write lock is acquired and when it is released, so it is odd while the object is write locked. Shares its cache line only with the rarely written combiner pointer, after the frequently written lock state. */
+		alignas(Layout::version_alignment) std::atomic<std::uint32_t> m_version;
+
+		/** The combiner's publication slots, allocated on the first call to `apply()`. */
+		std::atomic<helper::CombinerSlot<T> *> m_combiner;
 
 	public:
 		template<class ...Args>
@@ -263,79 +1071,257 @@ namespace lock
 		@param[in,out] move:
 			The thread safe object to move. */
 		ThreadSafe(
-			ThreadSafe<T> && move);
+			ThreadSafe<T, Layout, Engine> && move);
 
 		/** Destroys a thread safe object.
 			The object must not be locked. */
 		~ThreadSafe();
 
-		ThreadSafe<T> &operator=(
-			ThreadSafe<T> const&) = delete;
+		ThreadSafe<T, Layout, Engine> &operator=(
+			ThreadSafe<T, Layout, Engine> const&) = delete;
 
 		ThreadSafe(
-			ThreadSafe<T> const&) = delete;
+			ThreadSafe<T, Layout, Engine> const&) = delete;
 
 		/** Aquires a write lock.
 			This function blocks until a write lock is acquired. */
-		WriteLock<T> write();
+		WriteLock<T, Layout, Engine> write();
 		/** Attempts to aquire a write lock.
 			May fail, but does not block. */
-		WriteLock<T> try_write();
+		WriteLock<T, Layout, Engine> try_write();
 
 
 		/** Aquires a read lock.
 			This function blocks until a read lock is acquired. */
-		ReadLock<T> read();
+		ReadLock<T, Layout, Engine> read();
 		/** Attempts to acquire a read lock.
 			May fail, but does not block. */
-		ReadLock<T> try_read();
+		ReadLock<T, Layout, Engine> try_read();
+
+		/** Aquires an upgrade lock.
+			This function blocks until an upgrade lock is acquired. */
+		UpgradeLock<T, Layout, Engine> upgradeable_read();
+		/** Attempts to acquire an upgrade lock.
+			May fail, but does not block. */
+		UpgradeLock<T, Layout, Engine> try_upgradeable_read();
+
+		/** Starts an optimistic read.
+			Does not lock the object, and does not write to shared memory. Blocks while the object is write locked. Only available for trivially copyable objects. */
+		OptimisticReadLock<T, Layout, Engine> optimistic_read() const;
+		/** Copies the object without locking it.
+			Retries until it made a copy that was not modified concurrently. Does not write to shared memory, and so readers do not contend with each other. Only available for trivially copyable objects.
+		@return
+			A consistent copy of the object. */
+		T load() const;
+
+		template<class Fn>
+		/** Executes `fn` on the object under a write lock, using flat combining.
+			The call is published in a per-thread slot. Whichever thread holds the write lock executes all published calls before it releases the lock, so that the object stays in one core's cache, and the waiting threads only receive their results. Exceptions thrown by `fn` are rethrown to the caller. If the slot is taken by another thread, the call falls back to locking directly.
+		@param[in] fn:
+			Called with a `T &` to the object. Must not return a reference into the object.
+		@return
+			The result of `fn`. */
+		auto apply(
+			Fn &&fn) -> decltype(fn(std::declval<T &>()));
 
-		/** Tries to reserve the thread safe object. */
-		inline void reserve(
-			ticket_t priority);
+		template<class Fn>
+		/** Modifies the object optimistically.
+			Copies the object without locking it (see `load()`), applies `fn` to the copy, and then write locks the object only to store the copy back, if the object was not modified in the meantime. Otherwise, it retries. Unlike `apply()`, `fn` runs outside of the lock, and the write lock is only held for the copy. This is not lock-free: storing takes the write lock, and waits for it like `write()`. Usable alongside read, write and multi locks on the same object. Only available for trivially copyable objects; objects that fit a lock-free atomic can use `ThreadSafe<T, Layout, engine::Atomic>` instead.
+		@param[in] fn:
+			Called with a `T &` to the copy. May be called multiple times, and so must not have side effects.
+		@return
+			The value that was stored. */
+		T update(
+			Fn &&fn);
+
+		/** Tries to reserve the thread safe object.
+			Succeeds if the object is not reserved by an older ticket.
+		@param[in] ticket:
+			The current thread's ticket (see `helper::TicketScope`).
+		@return
+			Whether the object is reserved for `ticket` now. */
+		inline bool reserve(
+			ticket_t ticket);
 		/** Returns whether the thread safe object is reserved by any thread. */
 		inline bool reserved() const;
 
 	private:
-		/** Removes the current reservation, if exists. */
+		/** Removes the current reservation, if it is held by the current thread, and wakes the threads waiting for it. */
 		inline void unreserve();
 		/** Determines whether the current executing thread can claim the thread safe object. */
-		bool thread_can_claim();
-		/** Can be called within a context where the mutex is already locked. */
-		void reserve_locked(
-			ticket_t priority);
+		inline bool thread_can_claim() const;
+		/** Parks the current thread until a reservation is removed, if it cannot claim the object. May return spuriously.
+			The engine cannot see reservations, so blocked threads wait for them here, between locking attempts. */
+		void await_reservation();
+
+		/** Aquires a write lock, ignoring reservations.
+			This function blocks until a write lock is acquired. */
+		WriteLock<T, Layout, Engine> write_unreserved();
+		/** Aquires a read lock, ignoring reservations.
+			This function blocks until a read lock is acquired. */
+		ReadLock<T, Layout, Engine> read_unreserved();
+
+		/** Tries to acquire a write lock. Ignores reservations. */
+		inline bool try_lock_write();
+		/** Tries to acquire the upgrade lock. Ignores reservations. */
+		inline bool try_lock_upgrade();
+		template<class Claim>
+		/** Blocks until a write lock is acquired, after a failed `try_lock_write()`.
+		@param[in] claim:
+			Returns whether the current thread may take the lock right now (see `engine::LockWord::lock_write()`). Whenever it returns false, the thread waits for a reservation to be removed, and tries again.
+		@param[in] since:
+			When the acquisition started. */
+		void lock_write(
+			Claim &&claim,
+			helper::statistics::timestamp_t since);
+		template<class Claim>
+		/** Blocks until a read lock is acquired, after a failed `try_lock_read()` (see `lock_write()`). */
+		void lock_read(
+			Claim &&claim,
+			helper::statistics::timestamp_t since);
+		template<class Claim>
+		/** Blocks until the upgrade lock is acquired, after a failed `try_lock_upgrade()` (see `lock_write()`). */
+		void lock_upgrade(
+			Claim &&claim,
+			helper::statistics::timestamp_t since);
+		/** Records an acquired write lock and makes the version odd. */
+		inline void acquired_write();
+		/** Records an acquired read lock. */
+		inline void acquired_read();
+		/** Makes the version odd before the object is modified. Must hold the write lock. */
+		inline void begin_write();
+		/** Turns the held upgrade lock into a write lock.
+			Blocks new readers, and waits until the remaining readers have left. */
+		WriteLock<T, Layout, Engine> upgrade();
+		/** Turns the held write lock into a read lock, without unlocking in between. */
+		ReadLock<T, Layout, Engine> downgrade();
+		/** Releases an upgrade lock and wakes parked threads. */
+		inline void release_upgrade_lock();
+		/** Returns the combiner's publication slots, allocating them if needed. */
+		helper::CombinerSlot<T> * combiner();
+		/** Executes all published calls. Must hold the write lock. */
+		void combine();
+		/** Tries to acquire a read lock. Ignores reservations. */
+		inline bool try_lock_read();
+		/** Increments the read lock count of an already read locked object. */
+		inline void add_read_lock();
+		/** Releases a write lock and wakes parked threads. */
+		inline void release_write_lock();
+		/** Releases a read lock and wakes parked threads if it was the last one. */
+		inline void release_read_lock();
+		/** Records the start of a hold period for the contention statistics. */
+		inline void begin_hold();
+		/** Returns when the current hold period started, or zero if statistics are disabled. */
+		inline helper::statistics::timestamp_t locked_since() const;
+		/** Waits until the object is not write locked.
+		@return
+			The even version the object had. */
+		std::uint32_t stable_version() const;
+		/** Copies the object without locking it.
+			Retries until it made a copy that was not modified concurrently. Like every sequence lock read, the copy races with writers that hold the write lock, and may be torn; a torn copy is detected through the version and discarded, but race detectors (e.g., ThreadSanitizer) still report it.
+		@param[out] copy:
+			Storage for a `T`, receives the copy.
+		@return
+			The version of the copy. */
+		std::uint32_t snapshot(
+			void * copy) const;
+		/** Waits after a failed locking attempt (see `engine::LockWord::wait()`), or until a reservation is removed, if the current thread cannot claim the object.
+		@param[in] attempt:
+			The number of failed attempts so far.
+		@param[in] access:
+			The kind of lock that could not be acquired. */
+		void wait(
+			unsigned attempt,
+			engine::Access access);
 	};
 
-	template<class T>
+	template<class T, class Layout>
+	/** Lock-free thread safe object, for small shared counters, flags and pointers. Selected with `engine::Atomic`; `T` must fit a lock-free atomic (see `helper::fits_atomic`).
+		Keeps the object in a `std::atomic<T>`, without lock word, reservation or version. Reading maps onto an atomic load, writing onto an atomic store, and modifying onto a compare-and-swap loop, so that no thread ever blocks another. There are no read, write or upgrade locks, as they would hand out references into the object, and so the object cannot take part in `multi_lock()` or `range_lock()`: objects that have to be modified together with others need a lock engine. `T` should have no padding bits, which compare-and-swap would compare as well.
+	@tparam Layout:
+		The memory layout policy (see `lock::layout`). Only the object alignment applies, as there is no lock state. */
+	class ThreadSafe<T, Layout, engine::Atomic>
+	{
+		static_assert(helper::fits_atomic<T>::value,
+			"ThreadSafe<T, Layout, engine::Atomic> requires a trivially copyable type of 1, 2, 4 or 8 bytes.");
+
+		/** The thread safe object. */
+		alignas(Layout::object_alignment) std::atomic<T> m_object;
+
+	public:
+		template<class ...Args>
+		/** Creates a thread safe object with the given arguments.
+		@param[in] args:
+			The arguments used to construct the object. */
+		ThreadSafe(
+			Args&&... args);
+
+		/** Creates a thread safe object by moving.
+			The source object must not be accessed concurrently.
+		@param[in,out] move:
+			The thread safe object to move. */
+		ThreadSafe(
+			ThreadSafe<T, Layout, engine::Atomic> && move);
+
+		ThreadSafe<T, Layout, engine::Atomic> &operator=(
+			ThreadSafe<T, Layout, engine::Atomic> const&) = delete;
+
+		ThreadSafe(
+			ThreadSafe<T, Layout, engine::Atomic> const&) = delete;
+
+		/** Reads the object with a single atomic load. */
+		T load() const;
+		/** Replaces the object with a single atomic store.
+		@param[in] value:
+			The new value. */
+		void store(
+			T const& value);
+
+		template<class Fn>
+		/** Modifies the object in a compare-and-swap loop.
+			Applies `fn` to a copy of the object, and stores the copy if the object did not change in the meantime. Otherwise, it retries with the current value. Lock-free: a retry means that another thread's modification succeeded.
+		@param[in] fn:
+			Called with a `T &` to the copy. May be called multiple times, and so must not have side effects.
+		@return
+			The value that was stored. */
+		T update(
+			Fn &&fn);
+	};
+
+	template<class T, class Layout = layout::Compact, class Engine = engine::Futex>
+	/** The lock-free `ThreadSafe<T, Layout, engine::Atomic>` if `T` fits a lock-free atomic, otherwise `ThreadSafe<T, Layout, Engine>`. For objects that are only accessed through `load()` and `update()`, which both provide. */
+	using ThreadSafeValue = ThreadSafe<T, Layout, typename std::conditional<helper::fits_atomic<T>::value, engine::Atomic, Engine>::type>;
+
+	template<class T, class Layout, class Engine>
 	/** Scoped read lock class
 		See the descriptions for ThreadSafe.*/
 	class ReadLock
 	{
-		friend class ThreadSafe<T>;
+		friend class ThreadSafe<T, Layout, Engine>;
 
 		/** The proxy this lock is bound to. */
-		ThreadSafe<T> * m_proxy;
+		ThreadSafe<T, Layout, Engine> * m_proxy;
 
 		/** Creates a read lock bound to the given proxy.
 		@param[in] proxy:
 			The proxy that this lock is bound to. */
 		inline ReadLock(
-			ThreadSafe<T> & proxy,
-			typename ThreadSafe<T>::Authorised);
+			ThreadSafe<T, Layout, Engine> & proxy,
+			typename ThreadSafe<T, Layout, Engine>::Authorised);
 	public:
 		/** Creates an empty read lock. */
 		inline ReadLock();
 		/** Blocks the current thread until a lock on the resource could be optained.*/
 		ReadLock(
-			ThreadSafe<T> &proxy);
+			ThreadSafe<T, Layout, Engine> &proxy);
 		/** Copies the read lock. */
 		ReadLock(
-			ReadLock<T> const& other);
+			ReadLock<T, Layout, Engine> const& other);
 		/** Moves the lock ownership from `move`.
 		@param[in,out] move:
 			The read lock to move. */
 		ReadLock(
-			ReadLock<T> &&move);
+			ReadLock<T, Layout, Engine> &&move);
 		/** Releases the read lock. */
 		~ReadLock();
 
@@ -344,16 +1330,16 @@ namespace lock
 			The lock to copy.
 		@return
 			A reference to `this`. */
-		ReadLock<T> &operator=(
-			ReadLock<T> const& other);
+		ReadLock<T, Layout, Engine> &operator=(
+			ReadLock<T, Layout, Engine> const& other);
 		/** Copies a read lock.
 			Unlocks `this` if it is not empty.
 		@param[in] other:
 			The lock to copy.
 		@return
 			A reference to `this`. */
-		ReadLock<T> &operator=(
-			ReadLock<T> && other);
+		ReadLock<T, Layout, Engine> &operator=(
+			ReadLock<T, Layout, Engine> && other);
 
 		/** Accesses the locked object.
 		@return
@@ -370,25 +1356,67 @@ namespace lock
 
 		/** Locks a proxy. */
 		inline void lock(
-			ThreadSafe<T> &proxy);
+			ThreadSafe<T, Layout, Engine> &proxy);
 		/** Tries to lock a proxy. */
 		inline bool try_lock(
-			ThreadSafe<T> &proxy);
+			ThreadSafe<T, Layout, Engine> &proxy);
 		/** Releases the lock.
 			The object must be locked. */
 		inline void unlock();
 	};
 
-	template<class T>
+	template<class T, class Layout, class Engine>
+	/** Optimistic read of a thread safe object (sequence lock).
+		Does not lock the object: writers may modify it while it is being read. Everything read through the lock has to be validated using `valid()` before it is acted upon, and must be retried if validation fails. Only available for trivially copyable objects. */
+	class OptimisticReadLock
+	{
+		friend class ThreadSafe<T, Layout, Engine>;
+
+		/** The proxy this lock is bound to. */
+		ThreadSafe<T, Layout, Engine> const * m_proxy;
+		/** The version of the object when the read started. */
+		std::uint32_t m_version;
+
+		inline OptimisticReadLock(
+			ThreadSafe<T, Layout, Engine> const& proxy,
+			std::uint32_t version);
+	public:
+		/** Creates an empty optimistic read lock. */
+		inline OptimisticReadLock();
+		/** Starts an optimistic read on the given proxy.
+			Blocks while the proxy is write locked. */
+		OptimisticReadLock(
+			ThreadSafe<T, Layout, Engine> const& proxy);
+
+		/** Accesses the object. The values read must be validated. */
+		inline T const* operator->() const;
+		/** Accesses the object. The values read must be validated. */
+		inline T const& operator*() const;
+		/** Returns whether the optimistic read is bound to any proxy. */
+		inline bool locked() const;
+		/** Same as `locked()`. */
+		inline operator bool() const;
+
+		/** Returns whether the object was not modified since the read started.
+			Everything read through the lock before this call is consistent if it returns true. */
+		inline bool valid() const;
+		/** Restarts the read.
+			Blocks while the object is write locked. */
+		inline void retry();
+		/** Unbinds the lock from its proxy. */
+		inline void unlock();
+	};
+
+	template<class T, class Layout, class Engine>
 	/*Scoped write lock class. See the descriptions for ThreadSafe.*/
 	class WriteLock
 	{
-		friend class ThreadSafe<T>;
-		ThreadSafe<T> * m_proxy;
+		friend class ThreadSafe<T, Layout, Engine>;
+		ThreadSafe<T, Layout, Engine> * m_proxy;
 
 		inline WriteLock(
-			ThreadSafe<T> &proxy,
-			typename ThreadSafe<T>::Authorised);
+			ThreadSafe<T, Layout, Engine> &proxy,
+			typename ThreadSafe<T, Layout, Engine>::Authorised);
 	public:
 		inline WriteLock();
 		/** Creates a write lock bound to the given proxy.
@@ -396,12 +1424,12 @@ namespace lock
 		@param[in,out] proxy:
 			The thread safe object to lock. */
 		WriteLock(
-			ThreadSafe<T> &proxy);
+			ThreadSafe<T, Layout, Engine> &proxy);
 		/** Moves a write lock.
 		@param[in,out] move:
 			The write lock to move. */
 		WriteLock(
-			WriteLock<T> && move);
+			WriteLock<T, Layout, Engine> && move);
 		/** Releases the write lock. */
 		~WriteLock();
 		/** Moves a write lock.
@@ -410,8 +1438,8 @@ namespace lock
 			The write lock to move.
 		@return
 			A reference to `this`. */
-		WriteLock<T> &operator=(
-			WriteLock<T> && move);
+		WriteLock<T, Layout, Engine> &operator=(
+			WriteLock<T, Layout, Engine> && move);
 
 		inline T* operator->() const;
 		inline T& operator*() const;
@@ -419,16 +1447,85 @@ namespace lock
 		inline operator bool() const;
 
 		inline void lock(
-			ThreadSafe<T> &proxy);
+			ThreadSafe<T, Layout, Engine> &proxy);
 		inline bool try_lock(
-			ThreadSafe<T> &proxy);
+			ThreadSafe<T, Layout, Engine> &proxy);
 		inline void unlock();
+
+		/** Turns the write lock into a read lock.
+			The object is not unlocked in between, and waiting readers are admitted. `this` becomes empty.
+		@return
+			A read lock on the same object. */
+		ReadLock<T, Layout, Engine> downgrade();
+	};
+
+	template<class T, class Layout, class Engine>
+	/** Scoped upgrade lock class.
+		Grants read access like a `ReadLock`, and coexists with read locks, but excludes other upgrade locks and write locks. Can be atomically upgraded to a `WriteLock`. Use this for check-then-update code that usually only reads. */
+	class UpgradeLock
+	{
+		friend class ThreadSafe<T, Layout, Engine>;
+
+		/** The proxy this lock is bound to. */
+		ThreadSafe<T, Layout, Engine> * m_proxy;
+
+		inline UpgradeLock(
+			ThreadSafe<T, Layout, Engine> &proxy,
+			typename ThreadSafe<T, Layout, Engine>::Authorised);
+	public:
+		/** Creates an empty upgrade lock. */
+		inline UpgradeLock();
+		/** Creates an upgrade lock bound to the given proxy.
+			Blocks until a lock is obtained.
+		@param[in,out] proxy:
+			The thread safe object to lock. */
+		UpgradeLock(
+			ThreadSafe<T, Layout, Engine> &proxy);
+		/** Moves an upgrade lock.
+		@param[in,out] move:
+			The upgrade lock to move. */
+		UpgradeLock(
+			UpgradeLock<T, Layout, Engine> &&move);
+		/** Releases the upgrade lock. */
+		~UpgradeLock();
+		/** Moves an upgrade lock.
+			Unlocks `this` if it is not empty.
+		@param[in,out] move:
+			The upgrade lock to move.
+		@return
+			A reference to `this`. */
+		UpgradeLock<T, Layout, Engine> &operator=(
+			UpgradeLock<T, Layout, Engine> &&move);
+
+		inline T const* operator->() const;
+		inline T const& operator*() const;
+		inline bool locked() const;
+		inline operator bool() const;
+
+		inline void lock(
+			ThreadSafe<T, Layout, Engine> &proxy);
+		inline bool try_lock(
+			ThreadSafe<T, Layout, Engine> &proxy);
+		inline void unlock();
+
+		/** Turns the upgrade lock into a write lock.
+			The object is not unlocked in between. New readers are blocked, and the call waits until the remaining readers have left. `this` becomes empty.
+		@return
+			A write lock on the same object. */
+		WriteLock<T, Layout, Engine> upgrade();
 	};
 }
 
+#include "Park.inl"
+#include "Aligned.inl"
+#include "Statistics.inl"
+#include "Engine.inl"
 #include "ThreadSafe.inl"
+#include "AtomicThreadSafe.inl"
 #include "ReadLock.inl"
 #include "WriteLock.inl"
+#include "OptimisticReadLock.inl"
+#include "UpgradeLock.inl"
 
 
 #endif
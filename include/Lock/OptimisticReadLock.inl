@@ -0,0 +1,84 @@
+namespace lock
+{
+	template<class T, class Layout, class Engine>
+	OptimisticReadLock<T, Layout, Engine>::OptimisticReadLock(
+		ThreadSafe<T, Layout, Engine> const& proxy,
+		std::uint32_t version):
+		m_proxy(&proxy),
+		m_version(version)
+	{
+		static_assert(std::is_trivially_copyable<T>::value,
+			"OptimisticReadLock requires a trivially copyable type.");
+	}
+
+	template<class T, class Layout, class Engine>
+	OptimisticReadLock<T, Layout, Engine>::OptimisticReadLock():
+		m_proxy(nullptr),
+		m_version(0)
+	{
+	}
+
+	template<class T, class Layout, class Engine>
+	OptimisticReadLock<T, Layout, Engine>::OptimisticReadLock(
+		ThreadSafe<T, Layout, Engine> const& proxy):
+		OptimisticReadLock(proxy.optimistic_read())
+	{
+	}
+
+	template<class T, class Layout, class Engine>
+	T const * OptimisticReadLock<T, Layout, Engine>::operator->() const
+	{
+		assert(locked()
+			&& "Tried to access empty lock.");
+		return std::addressof(m_proxy->m_object);
+	}
+
+	template<class T, class Layout, class Engine>
+	T const& OptimisticReadLock<T, Layout, Engine>::operator*() const
+	{
+		assert(locked()
+			&& "Tried to access empty lock.");
+		return m_proxy->m_object;
+	}
+
+	template<class T, class Layout, class Engine>
+	bool OptimisticReadLock<T, Layout, Engine>::locked() const
+	{
+		return m_proxy != nullptr;
+	}
+
+	template<class T, class Layout, class Engine>
+	OptimisticReadLock<T, Layout, Engine>::operator bool() const
+	{
+		return locked();
+	}
+
+	template<class T, class Layout, class Engine>
+	bool OptimisticReadLock<T, Layout, Engine>::valid() const
+	{
+		assert(locked()
+			&& "Tried to validate empty lock.");
+
+		// order the preceding reads of the object before re-reading the version.
+		std::atomic_thread_fence(std::memory_order_acquire);
+		return m_proxy->m_version.load(std::memory_order_relaxed) == m_version;
+	}
+
+	template<class T, class Layout, class Engine>
+	void OptimisticReadLock<T, Layout, Engine>::retry()
+	{
+		assert(locked()
+			&& "Tried to retry empty lock.");
+
+		m_version = m_proxy->stable_version();
+	}
+
+	template<class T, class Layout, class Engine>
+	void OptimisticReadLock<T, Layout, Engine>::unlock()
+	{
+		assert(locked()
+			&& "Tried to unlock empty lock.");
+
+		m_proxy = nullptr;
+	}
+}
\ No newline at end of file
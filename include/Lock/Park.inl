@@ -0,0 +1,84 @@
+#if defined(__linux__)
+#include <climits>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#elif defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace lock
+{
+	namespace helper
+	{
+		void cpu_relax()
+		{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+			_mm_pause();
+#elif defined(__x86_64__) || defined(__i386__)
+			__builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+			__asm__ __volatile__("yield");
+#endif
+		}
+
+		void park(
+			std::atomic<std::uint32_t> &word,
+			std::uint32_t expected)
+		{
+#if defined(__linux__)
+			static_assert(sizeof(std::atomic<std::uint32_t>) == sizeof(int),
+				"futex words must be 32 bits wide.");
+			syscall(SYS_futex,
+				reinterpret_cast<int *>(&word),
+				FUTEX_WAIT_PRIVATE,
+				int(expected),
+				nullptr, nullptr, 0);
+#elif defined(__cpp_lib_atomic_wait)
+			word.wait(expected, std::memory_order_relaxed);
+#else
+			if(word.load(std::memory_order_relaxed) == expected)
+				std::this_thread::yield();
+#endif
+		}
+
+		void unpark_all(
+			std::atomic<std::uint32_t> &word)
+		{
+#if defined(__linux__)
+			syscall(SYS_futex,
+				reinterpret_cast<int *>(&word),
+				FUTEX_WAKE_PRIVATE,
+				INT_MAX,
+				nullptr, nullptr, 0);
+#elif defined(__cpp_lib_atomic_wait)
+			word.notify_all();
+#else
+			(void) word;
+#endif
+		}
+
+		void unpark_one(
+			std::atomic<std::uint32_t> &word)
+		{
+#if defined(__linux__)
+			syscall(SYS_futex,
+				reinterpret_cast<int *>(&word),
+				FUTEX_WAKE_PRIVATE,
+				1,
+				nullptr, nullptr, 0);
+#elif defined(__cpp_lib_atomic_wait)
+			word.notify_one();
+#else
+			(void) word;
+#endif
+		}
+
+		std::uint32_t thread_token()
+		{
+			static std::atomic<std::uint32_t> next(1);
+			static thread_local std::uint32_t const token = next.fetch_add(1, std::memory_order_relaxed);
+			return token;
+		}
+	}
+}
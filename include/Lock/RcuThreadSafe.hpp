@@ -0,0 +1,155 @@
+#ifndef __lock_rcuthreadsafe_hpp_defined
+#define __lock_rcuthreadsafe_hpp_defined
+
+#include "Lock.hpp"
+
+namespace lock
+{
+	template<class T>
+	class RcuThreadSafe;
+	template<class T>
+	class RcuReadLock;
+
+	namespace helper
+	{
+		/** A thread's read-side state in the global epoch domain. */
+		struct alignas(cache_line) EpochRecord
+		{
+			/** The epoch the thread observed when it entered its read-side critical section. Zero while the thread is outside of any. */
+			std::atomic<std::uint64_t> epoch;
+			/** Whether the record belongs to a live thread. */
+			std::atomic<bool> used;
+			/** The next record in the registry. */
+			EpochRecord * next;
+			/** The depth of nested read-side critical sections. Only accessed by the owning thread. */
+			unsigned nesting;
+
+			EpochRecord();
+		};
+
+		/** Returns the global epoch. Starts at 1, as 0 marks quiescent threads. */
+		inline std::atomic<std::uint64_t> &global_epoch();
+		/** Returns the head of the registry of all epoch records. Records are never freed, but reused after their thread exited. */
+		inline std::atomic<EpochRecord *> &epoch_records();
+		/** Returns the current thread's epoch record, registering the thread if needed. */
+		inline EpochRecord &epoch_record();
+
+		/** Enters a (possibly nested) read-side critical section on the current thread. */
+		inline void epoch_enter();
+		/** Leaves a read-side critical section on the current thread. */
+		inline void epoch_exit();
+		/** Waits for a grace period: until every read-side critical section that was entered before the call has been left.
+			Must not be called from within a read-side critical section. */
+		inline void epoch_synchronize();
+	}
+
+	template<class T>
+	/** Wrapper class for read-mostly shared resources using read-copy-update.
+		Readers never block and only write to their own thread's epoch record: they get a pointer to an immutable version of the object. Writers copy the current version, modify the copy, publish it atomically, and then wait for a grace period before destroying the old version. Writers are serialised among each other. Use this for objects that are read very often but rarely updated, as every update copies the whole object. Cannot be used with `multi_lock` or `range_lock`. */
+	class RcuThreadSafe
+	{
+		friend class RcuReadLock<T>;
+
+		/** The current version of the object. */
+		std::atomic<T const *> m_object;
+		/** Serialises writers. */
+		std::mutex m_writer;
+
+	public:
+		template<class ...Args>
+		/** Creates an RCU protected object with the given arguments.
+		@param[in] args:
+			The arguments used to construct the object. */
+		RcuThreadSafe(
+			Args&&... args);
+
+		/** Destroys the object.
+			There must not be any readers left. */
+		~RcuThreadSafe();
+
+		RcuThreadSafe(
+			RcuThreadSafe<T> const&) = delete;
+		RcuThreadSafe<T> &operator=(
+			RcuThreadSafe<T> const&) = delete;
+
+		/** Acquires a read lock on the current version.
+			Never blocks. */
+		RcuReadLock<T> read() const;
+
+		template<class Fn>
+		/** Copies the current version, applies `fn` to the copy, and publishes it.
+			Blocks until the old version is no longer read, then destroys it. Must not be called while the current thread holds an `RcuReadLock`.
+		@param[in] fn:
+			Called with a `T &` to the copy. */
+		void update(
+			Fn &&fn);
+
+		/** Publishes a new version of the object.
+			Blocks until the old version is no longer read, then destroys it. Must not be called while the current thread holds an `RcuReadLock`.
+		@param[in] value:
+			The new version. */
+		void store(
+			T value);
+
+	private:
+		/** Publishes a new version and destroys the old one after a grace period. Must hold `m_writer`.
+		@param[in] next:
+			The new version. */
+		void publish(
+			std::unique_ptr<T> next);
+	};
+
+	template<class T>
+	/** Scoped read lock on an `RcuThreadSafe`.
+		Keeps the version it was acquired on alive until it is released. Holding it delays writers, but never blocks other readers. Must be released on the thread that acquired it, and so it can only be moved, not copied. */
+	class RcuReadLock
+	{
+		friend class RcuThreadSafe<T>;
+
+		/** The version this lock protects. */
+		T const * m_object;
+
+		inline RcuReadLock(
+			RcuThreadSafe<T> const& proxy);
+	public:
+		/** Creates an empty read lock. */
+		inline RcuReadLock();
+		/** Moves the lock ownership from `move`.
+		@param[in,out] move:
+			The read lock to move. */
+		inline RcuReadLock(
+			RcuReadLock<T> &&move);
+		/** Releases the read lock. */
+		inline ~RcuReadLock();
+		/** Moves a read lock.
+			Unlocks `this` if it is not empty.
+		@param[in,out] move:
+			The lock to move.
+		@return
+			A reference to `this`. */
+		inline RcuReadLock<T> &operator=(
+			RcuReadLock<T> &&move);
+
+		RcuReadLock(
+			RcuReadLock<T> const&) = delete;
+		RcuReadLock<T> &operator=(
+			RcuReadLock<T> const&) = delete;
+
+		/** Accesses the locked version. */
+		inline T const* operator->() const;
+		/** Accesses the locked version. */
+		inline T const& operator*() const;
+		/** Returns whether the read lock is bound to any object. */
+		inline bool locked() const;
+		/** Same as `locked()`. */
+		inline operator bool() const;
+
+		/** Releases the lock.
+			The object must be locked. */
+		inline void unlock();
+	};
+}
+
+#include "RcuThreadSafe.inl"
+
+#endif
@@ -0,0 +1,246 @@
+namespace lock
+{
+	namespace helper
+	{
+		inline EpochRecord::EpochRecord():
+			epoch(0),
+			used(true),
+			next(nullptr),
+			nesting(0)
+		{
+		}
+
+		std::atomic<std::uint64_t> &global_epoch()
+		{
+			static std::atomic<std::uint64_t> epoch(1);
+			return epoch;
+		}
+
+		std::atomic<EpochRecord *> &epoch_records()
+		{
+			static std::atomic<EpochRecord *> head(nullptr);
+			return head;
+		}
+
+		EpochRecord &epoch_record()
+		{
+			/** Claims a record for the current thread and returns it when the thread exits. */
+			struct Registration
+			{
+				EpochRecord * record;
+
+				Registration():
+					record(nullptr)
+				{
+					// reuse the record of an exited thread, if possible.
+					for(EpochRecord * it = epoch_records().load(std::memory_order_acquire); it; it = it->next)
+					{
+						bool expected = false;
+						if(!it->used.load(std::memory_order_relaxed)
+						&& it->used.compare_exchange_strong(expected, true, std::memory_order_acquire))
+						{
+							record = it;
+							return;
+						}
+					}
+
+					// records are never freed, exited threads hand theirs on.
+					record = new_aligned<EpochRecord>(1);
+					record->next = epoch_records().load(std::memory_order_relaxed);
+					while(!epoch_records().compare_exchange_weak(
+						record->next,
+						record,
+						std::memory_order_release,
+						std::memory_order_relaxed));
+				}
+
+				~Registration()
+				{
+					assert(!record->nesting
+						&& "Thread exited while holding an RcuReadLock.");
+					record->used.store(false, std::memory_order_release);
+				}
+			};
+
+			static thread_local Registration registration;
+			return *registration.record;
+		}
+
+		void epoch_enter()
+		{
+			EpochRecord &record = epoch_record();
+			if(!record.nesting++)
+			{
+				record.epoch.store(global_epoch().load(std::memory_order_acquire), std::memory_order_relaxed);
+				// publish the epoch before reading any protected pointer (pairs with epoch_synchronize()).
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+			}
+		}
+
+		void epoch_exit()
+		{
+			EpochRecord &record = epoch_record();
+			assert(record.nesting
+				&& "Unbalanced epoch_exit().");
+			if(!--record.nesting)
+				record.epoch.store(0, std::memory_order_release);
+		}
+
+		void epoch_synchronize()
+		{
+			assert(!epoch_record().nesting
+				&& "Tried to wait for a grace period inside a read-side critical section.");
+
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			std::uint64_t const epoch = global_epoch().fetch_add(1, std::memory_order_seq_cst) + 1;
+
+			// wait for all readers that entered before the new epoch.
+			for(EpochRecord * it = epoch_records().load(std::memory_order_acquire); it; it = it->next)
+				for(unsigned attempt = 0;; attempt++)
+				{
+					std::uint64_t const observed = it->epoch.load(std::memory_order_seq_cst);
+					if(!observed || observed >= epoch)
+						break;
+
+					if(attempt < spin_attempts)
+						cpu_relax();
+					else
+						std::this_thread::yield();
+				}
+		}
+	}
+
+	template<class T>
+	template<class ...Args>
+	RcuThreadSafe<T>::RcuThreadSafe(
+		Args&&... args):
+		m_object(new T(std::forward<Args>(args)...)),
+		m_writer()
+	{
+	}
+
+	template<class T>
+	RcuThreadSafe<T>::~RcuThreadSafe()
+	{
+		delete m_object.load(std::memory_order_relaxed);
+	}
+
+	template<class T>
+	RcuReadLock<T> RcuThreadSafe<T>::read() const
+	{
+		return RcuReadLock<T>(*this);
+	}
+
+	template<class T>
+	template<class Fn>
+	void RcuThreadSafe<T>::update(
+		Fn &&fn)
+	{
+		std::lock_guard<std::mutex> lock(m_writer);
+
+		std::unique_ptr<T> next(new T(*m_object.load(std::memory_order_relaxed)));
+		std::forward<Fn>(fn)(*next);
+		publish(std::move(next));
+	}
+
+	template<class T>
+	void RcuThreadSafe<T>::store(
+		T value)
+	{
+		std::lock_guard<std::mutex> lock(m_writer);
+
+		publish(std::unique_ptr<T>(new T(std::move(value))));
+	}
+
+	template<class T>
+	void RcuThreadSafe<T>::publish(
+		std::unique_ptr<T> next)
+	{
+		std::unique_ptr<T const> old(m_object.exchange(next.release(), std::memory_order_seq_cst));
+		helper::epoch_synchronize();
+		// old is destroyed here, no reader can see it anymore.
+	}
+
+	template<class T>
+	RcuReadLock<T>::RcuReadLock(
+		RcuThreadSafe<T> const& proxy)
+	{
+		helper::epoch_enter();
+		m_object = proxy.m_object.load(std::memory_order_acquire);
+	}
+
+	template<class T>
+	RcuReadLock<T>::RcuReadLock():
+		m_object(nullptr)
+	{
+	}
+
+	template<class T>
+	RcuReadLock<T>::RcuReadLock(
+		RcuReadLock<T> &&move):
+		m_object(move.m_object)
+	{
+		move.m_object = nullptr;
+	}
+
+	template<class T>
+	RcuReadLock<T>::~RcuReadLock()
+	{
+		if(locked())
+			helper::epoch_exit();
+	}
+
+	template<class T>
+	RcuReadLock<T> &RcuReadLock<T>::operator=(
+		RcuReadLock<T> &&move)
+	{
+		if(this == &move)
+			return *this;
+
+		if(locked())
+			helper::epoch_exit();
+
+		m_object = move.m_object;
+		move.m_object = nullptr;
+
+		return *this;
+	}
+
+	template<class T>
+	T const * RcuReadLock<T>::operator->() const
+	{
+		assert(locked()
+			&& "Tried to access empty lock.");
+		return m_object;
+	}
+
+	template<class T>
+	T const& RcuReadLock<T>::operator*() const
+	{
+		assert(locked()
+			&& "Tried to access empty lock.");
+		return *m_object;
+	}
+
+	template<class T>
+	bool RcuReadLock<T>::locked() const
+	{
+		return m_object != nullptr;
+	}
+
+	template<class T>
+	RcuReadLock<T>::operator bool() const
+	{
+		return locked();
+	}
+
+	template<class T>
+	void RcuReadLock<T>::unlock()
+	{
+		assert(locked()
+			&& "Tried to unlock empty lock.");
+
+		helper::epoch_exit();
+		m_object = nullptr;
+	}
+}
@@ -1,77 +1,77 @@
 namespace lock
 {
-	template<class T>
-	ReadLock<T>::ReadLock(
-		ThreadSafe<T> & proxy,
-		typename ThreadSafe<T>::Authorised):
+	template<class T, class Layout, class Engine>
+	ReadLock<T, Layout, Engine>::ReadLock(
+		ThreadSafe<T, Layout, Engine> & proxy,
+		typename ThreadSafe<T, Layout, Engine>::Authorised):
 		m_proxy(&proxy)
 	{
 	}
 
-	template<class T>
-	ReadLock<T>::ReadLock():
+	template<class T, class Layout, class Engine>
+	ReadLock<T, Layout, Engine>::ReadLock():
 		m_proxy(nullptr)
 	{
 	}
 
-	template<class T>
-	ReadLock<T>::ReadLock(
-		ThreadSafe<T> &proxy):
+	template<class T, class Layout, class Engine>
+	ReadLock<T, Layout, Engine>::ReadLock(
+		ThreadSafe<T, Layout, Engine> &proxy):
 		ReadLock(proxy.read())
 	{
 	}
 
-	template<class T>
-	ReadLock<T>::ReadLock(
-		ReadLock<T> const& other):
+	template<class T, class Layout, class Engine>
+	ReadLock<T, Layout, Engine>::ReadLock(
+		ReadLock<T, Layout, Engine> const& other):
 		m_proxy(other.m_proxy)
 	{
 		if(m_proxy)
-			m_proxy->m_read_locks.fetch_add(1, std::memory_order_relaxed);
+			m_proxy->add_read_lock();
 	}
 
-	template<class T>
-	ReadLock<T>::ReadLock(
-		ReadLock<T> && move):
+	template<class T, class Layout, class Engine>
+	ReadLock<T, Layout, Engine>::ReadLock(
+		ReadLock<T, Layout, Engine> && move):
 		m_proxy(move.m_proxy)
 	{
 		move.m_proxy = nullptr;
 	}
 
-	template<class T>
-	ReadLock<T>::~ReadLock()
+	template<class T, class Layout, class Engine>
+	ReadLock<T, Layout, Engine>::~ReadLock()
 	{
 		if(locked())
-			m_proxy->m_read_locks.fetch_sub(1, std::memory_order_relaxed);
+			m_proxy->release_read_lock();
 	}
 
-	template<class T>
-	ReadLock<T> &ReadLock<T>::operator=(
-		ReadLock<T> const& other)
+	template<class T, class Layout, class Engine>
+	ReadLock<T, Layout, Engine> &ReadLock<T, Layout, Engine>::operator=(
+		ReadLock<T, Layout, Engine> const& other)
 	{
 		// unlock old proxy.
 		if(m_proxy && m_proxy != other.m_proxy)
-			m_proxy->m_read_locks.fetch_sub(1, std::memory_order_relaxed);
+			m_proxy->release_read_lock();
 
 		m_proxy = other.m_proxy;
 
 		// lock new proxy.
 		if(other.m_proxy)
-			other.m_proxy->m_read_locks.fetch_add(1, std::memory_order_relaxed);
+			other.m_proxy->add_read_lock();
 
 		return *this;
 	}
 
-	template<class T>
-	ReadLock<T> &ReadLock<T>::operator=(
-		ReadLock<T> && other)
+	template<class T, class Layout, class Engine>
+	ReadLock<T, Layout, Engine> &ReadLock<T, Layout, Engine>::operator=(
+		ReadLock<T, Layout, Engine> && other)
 	{
 		if(this == &other)
 			return *this;
 
 		// unlock old proxy.
 		if(m_proxy)
-			m_proxy->m_read_locks.fetch_sub(1, std::memory_order_relaxed);
+			m_proxy->release_read_lock();
 
 		m_proxy = other.m_proxy;
 		other.m_proxy = nullptr;
@@ -79,16 +79,16 @@ namespace lock
 		return *this;
 	}
 
-	template<class T>
-	T const * ReadLock<T>::operator->() const
+	template<class T, class Layout, class Engine>
+	T const * ReadLock<T, Layout, Engine>::operator->() const
 	{
 		assert(locked()
 			&& "Tried to access empty lock.");
 		return std::addressof(m_proxy->m_object);
 	}
 
-	template<class T>
-	T const& ReadLock<T>::operator*() const
+	template<class T, class Layout, class Engine>
+	T const& ReadLock<T, Layout, Engine>::operator*() const
 	{
 		assert(locked()
 			&& "Tried to access empty lock.");
@@ -96,40 +96,40 @@ namespace lock
 		return m_proxy->m_object;
 	}
 
-	template<class T>
-	bool ReadLock<T>::locked() const
+	template<class T, class Layout, class Engine>
+	bool ReadLock<T, Layout, Engine>::locked() const
 	{
 		return m_proxy != nullptr;
 	}
 
-	template<class T>
-	ReadLock<T>::operator bool() const
+	template<class T, class Layout, class Engine>
+	ReadLock<T, Layout, Engine>::operator bool() const
 	{
 		return locked();
 	}
 
 
-	template<class T>
-	void ReadLock<T>::lock(
-		ThreadSafe<T> &proxy)
+	template<class T, class Layout, class Engine>
+	void ReadLock<T, Layout, Engine>::lock(
+		ThreadSafe<T, Layout, Engine> &proxy)
 	{
 		*this = proxy.read();
 	}
 
-	template<class T>
-	bool ReadLock<T>::try_lock(
-		ThreadSafe<T> &proxy)
+	template<class T, class Layout, class Engine>
+	bool ReadLock<T, Layout, Engine>::try_lock(
+		ThreadSafe<T, Layout, Engine> &proxy)
 	{
 		return *this = proxy.try_read();
 	}
 
-	template<class T>
-	void ReadLock<T>::unlock()
+	template<class T, class Layout, class Engine>
+	void ReadLock<T, Layout, Engine>::unlock()
 	{
 		assert(locked()
 			&& "Tried to unlock empty lock.");
 
-		m_proxy->m_read_locks.fetch_sub(1, std::memory_order_relaxed);
+		m_proxy->release_read_lock();
 		m_proxy = nullptr;
 	}
 }
\ No newline at end of file
@@ -0,0 +1,216 @@
+#ifndef __lock_shardedthreadsafe_hpp_defined
+#define __lock_shardedthreadsafe_hpp_defined
+
+#include "Lock.hpp"
+
+namespace lock
+{
+	template<class T>
+	class ShardedThreadSafe;
+	template<class T>
+	class ShardedReadLock;
+	template<class T>
+	class ShardedWriteLock;
+
+	namespace helper
+	{
+		/** The number of reader counters of a sharded thread safe object. Must be a power of two. */
+		constexpr std::size_t reader_shards = 32;
+
+		/** A reader counter occupying its own cache line. */
+		struct alignas(cache_line) ReaderShard
+		{
+			/** The number of read locks held through this shard. */
+			std::atomic<std::uint32_t> readers;
+
+			ReaderShard();
+		};
+
+		/** Returns the reader shard the current thread uses. */
+		inline std::size_t reader_shard();
+	}
+
+	template<class T>
+	/** Wrapper class for read-mostly shared resources.
+		Behaves like `ThreadSafe`, but the read lock count is split across per-thread-slot counters that each occupy their own cache line, so that readers on different cores do not write to shared memory. Writers have to sweep all counters to wait for readers to leave, which makes write locking more expensive. Writers are preferred over new readers. Sharded thread safe objects cannot be used with `multi_lock` or `range_lock`, and do not support moving. */
+	class ShardedThreadSafe
+	{
+		friend class ShardedWriteLock<T>;
+		friend class ShardedReadLock<T>;
+
+		static struct Authorised { } const authorised;
+
+		/** The per-thread-slot read lock counts. */
+		helper::ReaderShard m_shards[helper::reader_shards];
+
+		/** The writer lock word.
+			Holds the write lock bit and the waiters bit (see `helper::state`). */
+		alignas(helper::cache_line) std::atomic<std::uint32_t> m_state;
+
+		/** The thread safe object. */
+		T m_object;
+
+	public:
+		template<class ...Args>
+		/** Creates a sharded thread safe object with the given arguments.
+		@param[in] args:
+			The arguments used to construct the object. */
+		ShardedThreadSafe(
+			Args&&... args);
+
+		/** Destroys a sharded thread safe object.
+			The object must not be locked. */
+		~ShardedThreadSafe();
+
+		ShardedThreadSafe(
+			ShardedThreadSafe<T> const&) = delete;
+		ShardedThreadSafe<T> &operator=(
+			ShardedThreadSafe<T> const&) = delete;
+
+		/** Aquires a write lock.
+			This function blocks until a write lock is acquired. */
+		ShardedWriteLock<T> write();
+		/** Attempts to aquire a write lock.
+			May fail, but does not block. */
+		ShardedWriteLock<T> try_write();
+
+		/** Aquires a read lock.
+			This function blocks until a read lock is acquired. */
+		ShardedReadLock<T> read();
+		/** Attempts to acquire a read lock.
+			May fail, but does not block. */
+		ShardedReadLock<T> try_read();
+
+	private:
+		/** Tries to increment the read lock count of the given shard.
+		@param[in] shard:
+			The shard to use. */
+		inline bool try_lock_read(
+			std::size_t shard);
+		/** Releases a read lock held through the given shard.
+		@param[in] shard:
+			The shard the lock was acquired through. */
+		inline void release_read_lock(
+			std::size_t shard);
+		/** Releases the write lock and wakes parked threads. */
+		inline void release_write_lock();
+		/** Waits until all readers have left. Must hold the write lock bit. */
+		void drain_readers();
+		/** Waits after a failed locking attempt.
+		@param[in] attempt:
+			The number of failed attempts so far. */
+		void wait(
+			unsigned attempt);
+	};
+
+	template<class T>
+	/** Scoped read lock on a `ShardedThreadSafe`.
+		Behaves like `ReadLock`. */
+	class ShardedReadLock
+	{
+		friend class ShardedThreadSafe<T>;
+
+		/** The proxy this lock is bound to. */
+		ShardedThreadSafe<T> * m_proxy;
+		/** The shard the lock was acquired through. */
+		std::size_t m_shard;
+
+		inline ShardedReadLock(
+			ShardedThreadSafe<T> &proxy,
+			std::size_t shard,
+			typename ShardedThreadSafe<T>::Authorised);
+	public:
+		/** Creates an empty read lock. */
+		inline ShardedReadLock();
+		/** Blocks the current thread until a lock on the resource could be optained. */
+		ShardedReadLock(
+			ShardedThreadSafe<T> &proxy);
+		/** Copies the read lock. */
+		ShardedReadLock(
+			ShardedReadLock<T> const& other);
+		/** Moves the lock ownership from `move`.
+		@param[in,out] move:
+			The read lock to move. */
+		ShardedReadLock(
+			ShardedReadLock<T> &&move);
+		/** Releases the read lock. */
+		~ShardedReadLock();
+
+		/** Copies a read lock.
+			Unlocks `this` if it is not empty.
+		@param[in] other:
+			The lock to copy.
+		@return
+			A reference to `this`. */
+		ShardedReadLock<T> &operator=(
+			ShardedReadLock<T> const& other);
+		/** Moves a read lock.
+			Unlocks `this` if it is not empty.
+		@param[in,out] move:
+			The lock to move.
+		@return
+			A reference to `this`. */
+		ShardedReadLock<T> &operator=(
+			ShardedReadLock<T> &&move);
+
+		/** Accesses the locked object. */
+		inline T const* operator->() const;
+		/** Accesses the locked object. */
+		inline T const& operator*() const;
+		/** Returns whether the read lock is bound to any proxy. */
+		inline bool locked() const;
+		/** Same as `locked()`. */
+		inline operator bool() const;
+
+		/** Releases the lock.
+			The object must be locked. */
+		inline void unlock();
+	};
+
+	template<class T>
+	/** Scoped write lock on a `ShardedThreadSafe`.
+		Behaves like `WriteLock`. */
+	class ShardedWriteLock
+	{
+		friend class ShardedThreadSafe<T>;
+
+		/** The proxy this lock is bound to. */
+		ShardedThreadSafe<T> * m_proxy;
+
+		inline ShardedWriteLock(
+			ShardedThreadSafe<T> &proxy,
+			typename ShardedThreadSafe<T>::Authorised);
+	public:
+		/** Creates an empty write lock. */
+		inline ShardedWriteLock();
+		/** Blocks the current thread until a lock on the resource could be optained. */
+		ShardedWriteLock(
+			ShardedThreadSafe<T> &proxy);
+		/** Moves a write lock.
+		@param[in,out] move:
+			The write lock to move. */
+		ShardedWriteLock(
+			ShardedWriteLock<T> &&move);
+		/** Releases the write lock. */
+		~ShardedWriteLock();
+		/** Moves a write lock.
+			Unlocks `this` if it is not empty.
+		@param[in,out] move:
+			The write lock to move.
+		@return
+			A reference to `this`. */
+		ShardedWriteLock<T> &operator=(
+			ShardedWriteLock<T> &&move);
+
+		inline T* operator->() const;
+		inline T& operator*() const;
+		inline bool locked() const;
+		inline operator bool() const;
+
+		inline void unlock();
+	};
+}
+
+#include "ShardedThreadSafe.inl"
+
+#endif
@@ -0,0 +1,396 @@
+namespace lock
+{
+	namespace helper
+	{
+		inline ReaderShard::ReaderShard():
+			readers(0)
+		{
+		}
+
+		std::size_t reader_shard()
+		{
+			static_assert((reader_shards & (reader_shards - 1)) == 0,
+				"reader_shards must be a power of two.");
+			return thread_token() & (reader_shards - 1);
+		}
+	}
+
+	template<class T>
+	template<class ...Args>
+	ShardedThreadSafe<T>::ShardedThreadSafe(
+		Args&&... args):
+		m_shards(),
+		m_state(0),
+		m_object(std::forward<Args>(args)...)
+	{
+	}
+
+	template<class T>
+	ShardedThreadSafe<T>::~ShardedThreadSafe()
+	{
+		assert(!(m_state.load(std::memory_order_relaxed) & helper::state::write));
+#ifndef NDEBUG
+		for(auto const& shard : m_shards)
+			assert(!shard.readers.load(std::memory_order_relaxed));
+#endif
+	}
+
+	template<class T>
+	ShardedWriteLock<T> ShardedThreadSafe<T>::write()
+	{
+		for(unsigned attempt = 0;; attempt++)
+		{
+			std::uint32_t state = m_state.load(std::memory_order_relaxed);
+			if(!(state & helper::state::write)
+			&& m_state.compare_exchange_weak(
+				state,
+				state | helper::state::write,
+				std::memory_order_seq_cst,
+				std::memory_order_relaxed))
+			{
+				// new readers back off now, wait for the old ones.
+				drain_readers();
+				return ShardedWriteLock<T>(*this, authorised);
+			}
+			wait(attempt);
+		}
+	}
+
+	template<class T>
+	ShardedWriteLock<T> ShardedThreadSafe<T>::try_write()
+	{
+		std::uint32_t state = m_state.load(std::memory_order_relaxed);
+		if(state & helper::state::write
+		|| !m_state.compare_exchange_strong(
+			state,
+			state | helper::state::write,
+			std::memory_order_seq_cst,
+			std::memory_order_relaxed))
+			return ShardedWriteLock<T>();
+
+		// set the write bit first, then check for readers (pairs with `try_lock_read()`). Both sides must be sequentially consistent, or each may miss the other.
+		for(auto const& shard : m_shards)
+			if(shard.readers.load(std::memory_order_seq_cst))
+			{
+				release_write_lock();
+				return ShardedWriteLock<T>();
+			}
+
+		return ShardedWriteLock<T>(*this, authorised);
+	}
+
+	template<class T>
+	ShardedReadLock<T> ShardedThreadSafe<T>::read()
+	{
+		std::size_t const shard = helper::reader_shard();
+		for(unsigned attempt = 0;; attempt++)
+		{
+			if(try_lock_read(shard))
+				return ShardedReadLock<T>(*this, shard, authorised);
+			wait(attempt);
+		}
+	}
+
+	template<class T>
+	ShardedReadLock<T> ShardedThreadSafe<T>::try_read()
+	{
+		std::size_t const shard = helper::reader_shard();
+		if(try_lock_read(shard))
+			return ShardedReadLock<T>(*this, shard, authorised);
+		else
+			return ShardedReadLock<T>();
+	}
+
+	template<class T>
+	bool ShardedThreadSafe<T>::try_lock_read(
+		std::size_t shard)
+	{
+		// announce the reader first, then check for writers (pairs with the writer's sweep).
+		m_shards[shard].readers.fetch_add(1, std::memory_order_seq_cst);
+		if(!(m_state.load(std::memory_order_seq_cst) & helper::state::write))
+			return true;
+
+		release_read_lock(shard);
+		return false;
+	}
+
+	template<class T>
+	void ShardedThreadSafe<T>::release_read_lock(
+		std::size_t shard)
+	{
+		std::atomic<std::uint32_t> &readers = m_shards[shard].readers;
+		// the last reader of a shard wakes a draining writer.
+		if(readers.fetch_sub(1, std::memory_order_seq_cst) == 1
+		&& (m_state.load(std::memory_order_seq_cst) & helper::state::write))
+			helper::unpark_all(readers);
+	}
+
+	template<class T>
+	void ShardedThreadSafe<T>::release_write_lock()
+	{
+		std::uint32_t const state = m_state.fetch_and(
+			~(helper::state::write | helper::state::waiters),
+			std::memory_order_release);
+
+		if(state & helper::state::waiters)
+			helper::unpark_all(m_state);
+	}
+
+	template<class T>
+	void ShardedThreadSafe<T>::drain_readers()
+	{
+		for(auto &shard : m_shards)
+			for(unsigned attempt = 0;; attempt++)
+			{
+				// sequentially consistent, like the write bit before it: pairs with `try_lock_read()`.
+				std::uint32_t const readers = shard.readers.load(std::memory_order_seq_cst);
+				if(!readers)
+					break;
+
+				if(attempt < helper::spin_attempts)
+					for(unsigned i = 0; i < (1u << attempt); i++)
+						helper::cpu_relax();
+				else
+					helper::park(shard.readers, readers);
+			}
+	}
+
+	template<class T>
+	void ShardedThreadSafe<T>::wait(
+		unsigned attempt)
+	{
+		if(attempt < helper::spin_attempts)
+		{
+			for(unsigned i = 0; i < (1u << attempt); i++)
+				helper::cpu_relax();
+			return;
+		}
+
+		std::uint32_t state = m_state.load(std::memory_order_relaxed);
+		if(!(state & helper::state::write))
+			return;
+
+		if(!(state & helper::state::waiters)
+		&& !m_state.compare_exchange_strong(
+			state,
+			state | helper::state::waiters,
+			std::memory_order_relaxed))
+			return;
+
+		helper::park(m_state, state | helper::state::waiters);
+	}
+
+	template<class T>
+	ShardedReadLock<T>::ShardedReadLock(
+		ShardedThreadSafe<T> &proxy,
+		std::size_t shard,
+		typename ShardedThreadSafe<T>::Authorised):
+		m_proxy(&proxy),
+		m_shard(shard)
+	{
+	}
+
+	template<class T>
+	ShardedReadLock<T>::ShardedReadLock():
+		m_proxy(nullptr),
+		m_shard(0)
+	{
+	}
+
+	template<class T>
+	ShardedReadLock<T>::ShardedReadLock(
+		ShardedThreadSafe<T> &proxy):
+		ShardedReadLock(proxy.read())
+	{
+	}
+
+	template<class T>
+	ShardedReadLock<T>::ShardedReadLock(
+		ShardedReadLock<T> const& other):
+		m_proxy(other.m_proxy),
+		m_shard(other.m_shard)
+	{
+		if(m_proxy)
+			m_proxy->m_shards[m_shard].readers.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	template<class T>
+	ShardedReadLock<T>::ShardedReadLock(
+		ShardedReadLock<T> &&move):
+		m_proxy(move.m_proxy),
+		m_shard(move.m_shard)
+	{
+		move.m_proxy = nullptr;
+	}
+
+	template<class T>
+	ShardedReadLock<T>::~ShardedReadLock()
+	{
+		if(locked())
+			m_proxy->release_read_lock(m_shard);
+	}
+
+	template<class T>
+	ShardedReadLock<T> &ShardedReadLock<T>::operator=(
+		ShardedReadLock<T> const& other)
+	{
+		if(this == &other)
+			return *this;
+
+		// lock the new proxy first, in case it is the old one.
+		if(other.m_proxy)
+			other.m_proxy->m_shards[other.m_shard].readers.fetch_add(1, std::memory_order_relaxed);
+		if(m_proxy)
+			m_proxy->release_read_lock(m_shard);
+
+		m_proxy = other.m_proxy;
+		m_shard = other.m_shard;
+
+		return *this;
+	}
+
+	template<class T>
+	ShardedReadLock<T> &ShardedReadLock<T>::operator=(
+		ShardedReadLock<T> &&move)
+	{
+		if(this == &move)
+			return *this;
+
+		if(m_proxy)
+			m_proxy->release_read_lock(m_shard);
+
+		m_proxy = move.m_proxy;
+		m_shard = move.m_shard;
+		move.m_proxy = nullptr;
+
+		return *this;
+	}
+
+	template<class T>
+	T const * ShardedReadLock<T>::operator->() const
+	{
+		assert(locked()
+			&& "Tried to access empty lock.");
+		return std::addressof(m_proxy->m_object);
+	}
+
+	template<class T>
+	T const& ShardedReadLock<T>::operator*() const
+	{
+		assert(locked()
+			&& "Tried to access empty lock.");
+		return m_proxy->m_object;
+	}
+
+	template<class T>
+	bool ShardedReadLock<T>::locked() const
+	{
+		return m_proxy != nullptr;
+	}
+
+	template<class T>
+	ShardedReadLock<T>::operator bool() const
+	{
+		return locked();
+	}
+
+	template<class T>
+	void ShardedReadLock<T>::unlock()
+	{
+		assert(locked()
+			&& "Tried to unlock empty lock.");
+
+		m_proxy->release_read_lock(m_shard);
+		m_proxy = nullptr;
+	}
+
+	template<class T>
+	ShardedWriteLock<T>::ShardedWriteLock(
+		ShardedThreadSafe<T> &proxy,
+		typename ShardedThreadSafe<T>::Authorised):
+		m_proxy(&proxy)
+	{
+	}
+
+	template<class T>
+	ShardedWriteLock<T>::ShardedWriteLock():
+		m_proxy(nullptr)
+	{
+	}
+
+	template<class T>
+	ShardedWriteLock<T>::ShardedWriteLock(
+		ShardedThreadSafe<T> &proxy):
+		ShardedWriteLock(proxy.write())
+	{
+	}
+
+	template<class T>
+	ShardedWriteLock<T>::ShardedWriteLock(
+		ShardedWriteLock<T> &&move):
+		m_proxy(move.m_proxy)
+	{
+		move.m_proxy = nullptr;
+	}
+
+	template<class T>
+	ShardedWriteLock<T>::~ShardedWriteLock()
+	{
+		if(locked())
+			m_proxy->release_write_lock();
+	}
+
+	template<class T>
+	ShardedWriteLock<T> &ShardedWriteLock<T>::operator=(
+		ShardedWriteLock<T> &&move)
+	{
+		if(&move == this)
+			return *this;
+
+		if(locked())
+			m_proxy->release_write_lock();
+
+		m_proxy = move.m_proxy;
+		move.m_proxy = nullptr;
+
+		return *this;
+	}
+
+	template<class T>
+	T * ShardedWriteLock<T>::operator->() const
+	{
+		assert(locked()
+			&& "Tried to access empty lock.");
+		return std::addressof(m_proxy->m_object);
+	}
+
+	template<class T>
+	T & ShardedWriteLock<T>::operator*() const
+	{
+		assert(locked()
+			&& "Tried to access empty lock.");
+		return m_proxy->m_object;
+	}
+
+	template<class T>
+	bool ShardedWriteLock<T>::locked() const
+	{
+		return m_proxy != nullptr;
+	}
+
+	template<class T>
+	ShardedWriteLock<T>::operator bool() const
+	{
+		return locked();
+	}
+
+	template<class T>
+	void ShardedWriteLock<T>::unlock()
+	{
+		assert(locked()
+			&& "Tried to unlock empty lock.");
+
+		m_proxy->release_write_lock();
+		m_proxy = nullptr;
+	}
+}
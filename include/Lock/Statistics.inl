@@ -0,0 +1,442 @@
+namespace lock
+{
+	namespace helper
+	{
+		namespace statistics
+		{
+#ifdef LOCK_STATISTICS
+			inline Entry::Entry():
+				object(nullptr),
+				counters()
+			{
+			}
+
+			inline MultiLockEntry::MultiLockEntry():
+				used(false),
+				site(nullptr),
+				size(0),
+				calls(0),
+				retries(0),
+				wins(0),
+				losses(0),
+				retry_histogram(),
+				time_histogram()
+			{
+			}
+
+			inline Buffer::Buffer():
+				entries(),
+				overflow(),
+				multi_locks(),
+				multi_lock_overflow(),
+				used(true),
+				next(nullptr)
+			{
+			}
+
+			std::atomic<Buffer *> &buffers()
+			{
+				static std::atomic<Buffer *> head(nullptr);
+				return head;
+			}
+
+			Buffer &buffer()
+			{
+				/** Claims a buffer for the current thread and returns it when the thread exits. */
+				struct Registration
+				{
+					Buffer * buffer;
+
+					Registration():
+						buffer(nullptr)
+					{
+						// reuse the buffer of an exited thread, if possible.
+						for(Buffer * it = buffers().load(std::memory_order_acquire); it; it = it->next)
+						{
+							bool expected = false;
+							if(!it->used.load(std::memory_order_relaxed)
+							&& it->used.compare_exchange_strong(expected, true, std::memory_order_acquire))
+							{
+								buffer = it;
+								return;
+							}
+						}
+
+						buffer = new Buffer();
+						buffer->next = buffers().load(std::memory_order_relaxed);
+						while(!buffers().compare_exchange_weak(
+							buffer->next,
+							buffer,
+							std::memory_order_release,
+							std::memory_order_relaxed));
+					}
+
+					~Registration()
+					{
+						buffer->used.store(false, std::memory_order_release);
+					}
+				};
+
+				static thread_local Registration registration;
+				return *registration.buffer;
+			}
+
+			void add(
+				void const * object,
+				Counter counter,
+				std::uint64_t amount)
+			{
+				Buffer &own = buffer();
+				Entry * entry = &own.overflow;
+
+				std::size_t const hash = std::size_t(
+					(reinterpret_cast<std::uintptr_t>(object) >> 4) * 0x9e3779b97f4a7c15ull >> 32);
+				for(std::size_t i = 0; i < buffer_probes; i++)
+				{
+					Entry &probed = own.entries[(hash + i) & (buffer_entries - 1)];
+					void const * const key = probed.object.load(std::memory_order_relaxed);
+					if(key == object)
+					{
+						entry = &probed;
+						break;
+					}
+					if(!key)
+					{
+						// only the owner inserts, snapshots see the key before the counters.
+						probed.object.store(object, std::memory_order_release);
+						entry = &probed;
+						break;
+					}
+				}
+
+				// only the owner writes, so no read-modify-write is needed.
+				std::atomic<std::uint64_t> &value = entry->counters[counter];
+				value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+			}
+
+			char const * &call_site()
+			{
+				static thread_local char const * site = nullptr;
+				return site;
+			}
+
+			std::size_t bucket(
+				std::uint64_t value)
+			{
+				std::size_t bits = 0;
+				while(value && bits < MultiLockStatistics::buckets - 1)
+				{
+					value >>= 1;
+					bits++;
+				}
+				return bits;
+			}
+
+			void increase(
+				std::atomic<std::uint64_t> &counter,
+				std::uint64_t amount)
+			{
+				counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+			}
+#endif
+
+			template<class ...InputIterator>
+			std::size_t range_size(
+				Range<InputIterator>... ranges)
+			{
+#ifdef LOCK_STATISTICS
+				std::size_t const sizes[] = { std::size_t(std::distance(ranges.begin(), ranges.end()))... };
+				std::size_t size = 0;
+				for(std::size_t range : sizes)
+					size += range;
+				return size;
+#else
+				(void) std::initializer_list<int>{ ((void) ranges, 0)... };
+				return 0;
+#endif
+			}
+
+			MultiLockProbe::MultiLockProbe(
+				std::size_t size)
+#ifdef LOCK_STATISTICS
+				: m_size(size),
+				m_start(now()),
+				m_retries(0),
+				m_wins(0),
+				m_losses(0)
+#endif
+			{
+#ifndef LOCK_STATISTICS
+				(void) size;
+#endif
+			}
+
+			void MultiLockProbe::reserved(
+				std::size_t wins)
+			{
+#ifdef LOCK_STATISTICS
+				m_retries++;
+				m_wins += wins;
+				m_losses += m_size - wins;
+#else
+				(void) wins;
+#endif
+			}
+
+			void MultiLockProbe::acquired()
+			{
+#ifdef LOCK_STATISTICS
+				Buffer &own = buffer();
+				char const * const site = call_site();
+				MultiLockEntry * entry = &own.multi_lock_overflow;
+
+				std::size_t const hash = std::size_t(
+					((reinterpret_cast<std::uintptr_t>(site) >> 3) ^ m_size) * 0x9e3779b97f4a7c15ull >> 32);
+				for(std::size_t i = 0; i < buffer_probes; i++)
+				{
+					MultiLockEntry &probed = own.multi_locks[(hash + i) & (multi_lock_entries - 1)];
+					if(!probed.used.load(std::memory_order_relaxed))
+					{
+						// only the owner inserts, snapshots see the key before the counters.
+						probed.site.store(site, std::memory_order_relaxed);
+						probed.size.store(m_size, std::memory_order_relaxed);
+						probed.used.store(true, std::memory_order_release);
+						entry = &probed;
+						break;
+					}
+					if(probed.site.load(std::memory_order_relaxed) == site
+					&& probed.size.load(std::memory_order_relaxed) == m_size)
+					{
+						entry = &probed;
+						break;
+					}
+				}
+
+				increase(entry->calls, 1);
+				increase(entry->retries, m_retries);
+				increase(entry->wins, m_wins);
+				increase(entry->losses, m_losses);
+				increase(entry->retry_histogram[bucket(m_retries)], 1);
+				increase(entry->time_histogram[bucket(now() - m_start)], 1);
+#endif
+			}
+
+			timestamp_t now()
+			{
+#ifdef LOCK_STATISTICS
+				return std::chrono::duration_cast<std::chrono::nanoseconds>(
+					std::chrono::steady_clock::now().time_since_epoch()).count();
+#else
+				return 0;
+#endif
+			}
+
+			void acquired(
+				void const * object)
+			{
+#ifdef LOCK_STATISTICS
+				add(object, acquisitions, 1);
+#else
+				(void) object;
+#endif
+			}
+
+			void waited(
+				void const * object,
+				unsigned attempt)
+			{
+#ifdef LOCK_STATISTICS
+				add(object, attempt < spin_attempts ? spins : parks, 1);
+#else
+				(void) object;
+				(void) attempt;
+#endif
+			}
+
+			void contended(
+				void const * object,
+				timestamp_t since)
+			{
+#ifdef LOCK_STATISTICS
+				add(object, contended_acquisitions, 1);
+				add(object, wait_time, now() - since);
+#else
+				(void) object;
+				(void) since;
+#endif
+			}
+
+			void held(
+				void const * object,
+				timestamp_t since)
+			{
+#ifdef LOCK_STATISTICS
+				timestamp_t const end = now();
+				// a new reader may have restarted the period concurrently.
+				if(end > since)
+					add(object, hold_time, end - since);
+#else
+				(void) object;
+				(void) since;
+#endif
+			}
+		}
+	}
+
+#ifdef LOCK_STATISTICS
+	std::vector<MultiLockStatistics> multi_lock_snapshot()
+	{
+		std::vector<MultiLockStatistics> merged;
+
+		auto merge = [&merged](helper::statistics::MultiLockEntry const& entry, char const * site, std::size_t size) {
+			std::uint64_t const calls = entry.calls.load(std::memory_order_relaxed);
+			if(!calls)
+				return;
+
+			auto it = std::find_if(merged.begin(), merged.end(),
+				[site, size](MultiLockStatistics const& stats) {
+					return stats.site == site && stats.size == size;
+				});
+			if(it == merged.end())
+			{
+				MultiLockStatistics created = MultiLockStatistics();
+				created.site = site;
+				created.size = size;
+				merged.push_back(created);
+				it = merged.end() - 1;
+			}
+
+			it->calls += calls;
+			it->retries += entry.retries.load(std::memory_order_relaxed);
+			it->reservation_wins += entry.wins.load(std::memory_order_relaxed);
+			it->reservation_losses += entry.losses.load(std::memory_order_relaxed);
+			for(std::size_t i = 0; i < MultiLockStatistics::buckets; i++)
+			{
+				it->retry_histogram[i] += entry.retry_histogram[i].load(std::memory_order_relaxed);
+				it->time_histogram[i] += entry.time_histogram[i].load(std::memory_order_relaxed);
+			}
+		};
+
+		for(helper::statistics::Buffer * buffer = helper::statistics::buffers().load(std::memory_order_acquire);
+			buffer;
+			buffer = buffer->next)
+		{
+			for(auto const& entry : buffer->multi_locks)
+				if(entry.used.load(std::memory_order_acquire))
+					merge(entry,
+						entry.site.load(std::memory_order_relaxed),
+						entry.size.load(std::memory_order_relaxed));
+			// calls that did not fit are reported as an unnamed site with size 0.
+			merge(buffer->multi_lock_overflow, nullptr, 0);
+		}
+
+		std::sort(merged.begin(), merged.end(),
+			[](MultiLockStatistics const& a, MultiLockStatistics const& b) {
+				return a.retries > b.retries;
+			});
+		return merged;
+	}
+
+	std::vector<ContentionStatistics> contention_snapshot(
+		std::size_t count)
+	{
+		std::unordered_map<void const *, ContentionStatistics> merged;
+
+		auto merge = [&merged](helper::statistics::Entry const& entry, void const * object) {
+			using namespace helper::statistics;
+			std::uint64_t counters[counter_count];
+			bool recorded = false;
+			for(std::size_t i = 0; i < counter_count; i++)
+				recorded |= (counters[i] = entry.counters[i].load(std::memory_order_relaxed)) != 0;
+			if(!recorded)
+				return;
+
+			auto inserted = merged.emplace(object, ContentionStatistics{object, 0, 0, 0, 0, 0, 0});
+			ContentionStatistics &stats = inserted.first->second;
+			stats.acquisitions += counters[acquisitions];
+			stats.contended += counters[contended_acquisitions];
+			stats.spins += counters[spins];
+			stats.parks += counters[parks];
+			stats.wait_time += counters[wait_time];
+			stats.hold_time += counters[hold_time];
+		};
+
+		for(helper::statistics::Buffer * buffer = helper::statistics::buffers().load(std::memory_order_acquire);
+			buffer;
+			buffer = buffer->next)
+		{
+			for(auto const& entry : buffer->entries)
+				if(void const * object = entry.object.load(std::memory_order_acquire))
+					merge(entry, object);
+			merge(buffer->overflow, nullptr);
+		}
+
+		std::vector<ContentionStatistics> sorted;
+		sorted.reserve(merged.size());
+		for(auto const& it : merged)
+			sorted.push_back(it.second);
+
+		std::sort(sorted.begin(), sorted.end(),
+			[](ContentionStatistics const& a, ContentionStatistics const& b) {
+				return a.wait_time != b.wait_time
+					? a.wait_time > b.wait_time
+					: a.contended > b.contended;
+			});
+
+		if(sorted.size() > count)
+			sorted.resize(count);
+		return sorted;
+	}
+#endif
+
+	namespace helper
+	{
+		std::uint64_t histogram_percentile(
+			std::uint64_t const (&histogram)[MultiLockStatistics::buckets],
+			double percentile)
+		{
+			std::uint64_t total = 0;
+			for(std::uint64_t count : histogram)
+				total += count;
+
+			std::uint64_t const rank = std::uint64_t(percentile * total);
+			std::uint64_t seen = 0;
+			for(std::size_t i = 0; i < MultiLockStatistics::buckets; i++)
+				if((seen += histogram[i]) > rank || seen == total)
+					return i ? (std::uint64_t(1) << i) - 1 : 0;
+			return 0;
+		}
+	}
+
+	std::uint64_t MultiLockStatistics::retry_percentile(
+		double percentile) const
+	{
+		return helper::histogram_percentile(retry_histogram, percentile);
+	}
+
+	std::uint64_t MultiLockStatistics::time_percentile(
+		double percentile) const
+	{
+		return helper::histogram_percentile(time_histogram, percentile);
+	}
+
+	CallSite::CallSite(
+		char const * name)
+#ifdef LOCK_STATISTICS
+		: m_previous(helper::statistics::call_site())
+#endif
+	{
+#ifdef LOCK_STATISTICS
+		helper::statistics::call_site() = name;
+#else
+		(void) name;
+#endif
+	}
+
+	CallSite::~CallSite()
+	{
+#ifdef LOCK_STATISTICS
+		helper::statistics::call_site() = m_previous;
+#endif
+	}
+}
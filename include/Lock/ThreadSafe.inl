@@ -3,30 +3,30 @@ namespace lock
 	namespace helper
 	{
 		inline void unlock(void) { }
-		template<class T, class ...Targs>
-		inline void unlock(ReadLock<T> &obj, Targs&... args)
+		template<class T, class Layout, class Engine, class ...Targs>
+		inline void unlock(ReadLock<T, Layout, Engine> &obj, Targs&... args)
 		{
 			if(obj.locked())
 				obj.unlock();
 			unlock(args...);
 		}
-		template<class T, class ...Targs>
-		inline void unlock(WriteLock<T> &obj, Targs&... args)
+		template<class T, class Layout, class Engine, class ...Targs>
+		inline void unlock(WriteLock<T, Layout, Engine> &obj, Targs&... args)
 		{
 			if(obj.locked())
 				obj.unlock();
 			unlock(args...);
 		}
 
-		template<class T>
+		template<class T, class Layout, class Engine>
 		inline bool try_lock(
-			WriteLockPair<T> &pair)
+			WriteLockPair<T, Layout, Engine> &pair)
 		{
 			return pair.lock.try_lock(pair.thread_safe);
 		}
-		template<class T>
+		template<class T, class Layout, class Engine>
 		inline bool try_lock(
-			ReadLockPair<T> &pair)
+			ReadLockPair<T, Layout, Engine> &pair)
 		{
 			return pair.lock.try_lock(pair.thread_safe);
 		}
@@ -49,42 +49,45 @@ namespace lock
 				return false;
 		}
 
-		template<class T>
-		inline void reserve(
+		template<class T, class Layout, class Engine>
+		inline std::size_t reserve(
 			ticket_t ticket,
-			ThreadSafe<T> &ts)
+			ThreadSafe<T, Layout, Engine> &ts)
 		{
-			ts.reserve(ticket);
+			return ts.reserve(ticket);
 		}
 
-		template<class T, class ...Ts>
-		inline void reserve(
+		template<class T, class Layout, class Engine, class ...Ts>
+		inline std::size_t reserve(
 			ticket_t ticket,
-			ThreadSafe<T> &ts,
-			ThreadSafe<Ts> &... rest)
+			ThreadSafe<T, Layout, Engine> &ts,
+			Ts &... rest)
 		{
-			reserve(ticket, rest...);
+			std::size_t const won = ts.reserve(ticket);
+			return won + reserve(ticket, rest...);
 		}
 
 
 		template<class T>
-		void reserve_ranges(
+		std::size_t reserve_ranges(
 			ticket_t ticket,
 			Range<T> range)
 		{
+			std::size_t won = 0;
 			for(auto it : range)
-				reserve(ticket, it.thread_safe);
+				won += reserve(ticket, it.thread_safe);
+			return won;
 		}
 
 		template<class T, class U, class ... Trest>
-		void reserve_ranges(
+		std::size_t reserve_ranges(
 			ticket_t ticket,
 			Range<T> range,
 			Range<U> rest0,
 			Range<Trest> ...restN)
 		{
-			reserve_ranges(ticket, range);
-			reserve_ranges(ticket, rest0, restN...);
+			std::size_t const won = reserve_ranges(ticket, range);
+			return won + reserve_ranges(ticket, rest0, restN...);
 		}
 
 		template<class T>
@@ -119,6 +122,181 @@ namespace lock
 			} else
 				return false;
 		}
+
+		template<class T, class Layout, class Engine>
+		Acquisition::Acquisition(
+			ReadLockPair<T, Layout, Engine> &pair):
+			key(std::addressof(pair.thread_safe)),
+			pair(std::addressof(pair)),
+			acquire(&acquire_read<T, Layout, Engine>)
+		{
+		}
+
+		template<class T, class Layout, class Engine>
+		Acquisition::Acquisition(
+			WriteLockPair<T, Layout, Engine> &pair):
+			key(std::addressof(pair.thread_safe)),
+			pair(std::addressof(pair)),
+			acquire(&acquire_write<T, Layout, Engine>)
+		{
+		}
+
+		bool Acquisition::operator<(
+			Acquisition const& other) const
+		{
+			return std::less<void const *>()(key, other.key);
+		}
+
+		template<class T, class Layout, class Engine>
+		void Acquisition::acquire_read(
+			void * pair)
+		{
+			ReadLockPair<T, Layout, Engine> &read = *static_cast<ReadLockPair<T, Layout, Engine> *>(pair);
+			read.lock = read.thread_safe.read_unreserved();
+		}
+
+		template<class T, class Layout, class Engine>
+		void Acquisition::acquire_write(
+			void * pair)
+		{
+			WriteLockPair<T, Layout, Engine> &write = *static_cast<WriteLockPair<T, Layout, Engine> *>(pair);
+			write.lock = write.thread_safe.write_unreserved();
+		}
+
+		inline void collect_ranges(
+			std::vector<Acquisition> &)
+		{
+		}
+
+		template<class T, class ...Trest>
+		void collect_ranges(
+			std::vector<Acquisition> &acquisitions,
+			Range<T> range,
+			Range<Trest> ...rest)
+		{
+			for(auto it = range.begin(); it != range.end(); it++)
+				acquisitions.emplace_back(*it);
+			collect_ranges(acquisitions, rest...);
+		}
+
+		ticket_t next_ticket()
+		{
+			static std::atomic<ticket_t> next(1);
+			return next.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		ticket_t &current_ticket()
+		{
+			static thread_local ticket_t ticket = 0;
+			return ticket;
+		}
+
+		TicketScope::TicketScope():
+			m_previous(current_ticket()),
+			m_ticket(next_ticket())
+		{
+			current_ticket() = m_ticket;
+		}
+
+		TicketScope::~TicketScope()
+		{
+			current_ticket() = m_previous;
+		}
+
+		ticket_t TicketScope::ticket() const
+		{
+			return m_ticket;
+		}
+
+		template<class T>
+		CombinerRequest<T>::CombinerRequest(
+			void (*execute)(CombinerRequest<T> &, T &)):
+			execute(execute),
+			done(false),
+			error()
+		{
+		}
+
+		template<class T, class Fn, class R>
+		CombinerCall<T, Fn, R>::CombinerCall(
+			Fn &fn):
+			CombinerRequest<T>(&CombinerCall::execute),
+			fn(fn)
+		{
+		}
+
+		template<class T, class Fn, class R>
+		CombinerCall<T, Fn, R>::~CombinerCall()
+		{
+			if(this->done.load(std::memory_order_relaxed) && !this->error)
+				reinterpret_cast<R &>(value).~R();
+		}
+
+		template<class T, class Fn, class R>
+		void CombinerCall<T, Fn, R>::execute(
+			CombinerRequest<T> &request,
+			T &object)
+		{
+			CombinerCall &call = static_cast<CombinerCall &>(request);
+			try {
+				new (&call.value) R(call.fn(object));
+			} catch(...)
+			{
+				call.error = std::current_exception();
+			}
+		}
+
+		template<class T, class Fn, class R>
+		R CombinerCall<T, Fn, R>::result()
+		{
+			if(this->error)
+				std::rethrow_exception(this->error);
+			return std::move(reinterpret_cast<R &>(value));
+		}
+
+		template<class T, class Fn>
+		CombinerCall<T, Fn, void>::CombinerCall(
+			Fn &fn):
+			CombinerRequest<T>(&CombinerCall::execute),
+			fn(fn)
+		{
+		}
+
+		template<class T, class Fn>
+		void CombinerCall<T, Fn, void>::execute(
+			CombinerRequest<T> &request,
+			T &object)
+		{
+			CombinerCall &call = static_cast<CombinerCall &>(request);
+			try {
+				call.fn(object);
+			} catch(...)
+			{
+				call.error = std::current_exception();
+			}
+		}
+
+		template<class T, class Fn>
+		void CombinerCall<T, Fn, void>::result()
+		{
+			if(this->error)
+				std::rethrow_exception(this->error);
+		}
+
+		template<class T>
+		CombinerSlot<T>::CombinerSlot():
+			request(nullptr)
+		{
+		}
+
+		inline void acquire_ordered(
+			Acquisition * begin,
+			Acquisition * end)
+		{
+			std::sort(begin, end);
+			for(; begin != end; begin++)
+				begin->acquire(begin->pair);
+		}
 	}
 
 	template<class T>
@@ -142,36 +320,36 @@ namespace lock
 		return m_end;
 	}
 
-	template<class T>
-	ReadLockPair<T>::ReadLockPair(
-		ReadLock<T> &lock,
-		ThreadSafe<T> &thread_safe):
+	template<class T, class Layout, class Engine>
+	ReadLockPair<T, Layout, Engine>::ReadLockPair(
+		ReadLock<T, Layout, Engine> &lock,
+		ThreadSafe<T, Layout, Engine> &thread_safe):
 		lock(lock),
 		thread_safe(thread_safe)
 	{
 	}
 
-	template<class T>
-	WriteLockPair<T>::WriteLockPair(
-		WriteLock<T> &lock,
-		ThreadSafe<T> &thread_safe):
+	template<class T, class Layout, class Engine>
+	WriteLockPair<T, Layout, Engine>::WriteLockPair(
+		WriteLock<T, Layout, Engine> &lock,
+		ThreadSafe<T, Layout, Engine> &thread_safe):
 		lock(lock),
 		thread_safe(thread_safe)
 	{
 	}
 
-	template<class T>
-	ReadLockPair<T> pair(
-		ReadLock<T> &lock,
-		ThreadSafe<T> &thread_safe)
+	template<class T, class Layout, class Engine>
+	ReadLockPair<T, Layout, Engine> pair(
+		ReadLock<T, Layout, Engine> &lock,
+		ThreadSafe<T, Layout, Engine> &thread_safe)
 	{
 		return { lock, thread_safe };
 	}
 
-	template<class T>
-	WriteLockPair<T> pair(
-		WriteLock<T> &lock,
-		ThreadSafe<T> &thread_safe)
+	template<class T, class Layout, class Engine>
+	WriteLockPair<T, Layout, Engine> pair(
+		WriteLock<T, Layout, Engine> &lock,
+		ThreadSafe<T, Layout, Engine> &thread_safe)
 	{
 		return { lock, thread_safe };
 	}
@@ -187,225 +365,677 @@ namespace lock
 
 
 
-	template<class T>
-	WriteLock<T> write_lock(
-		ThreadSafe<T> &thread_safe)
+	template<class T, class Layout, class Engine>
+	WriteLock<T, Layout, Engine> write_lock(
+		ThreadSafe<T, Layout, Engine> &thread_safe)
 	{
-		return WriteLock<T>(thread_safe);
+		return WriteLock<T, Layout, Engine>(thread_safe);
 	}
 
-	template<class T>
-	ReadLock<T> read_lock(
-		ThreadSafe<T> &thread_safe)
+	template<class T, class Layout, class Engine>
+	ReadLock<T, Layout, Engine> read_lock(
+		ThreadSafe<T, Layout, Engine> &thread_safe)
 	{
-		return ReadLock<T>(thread_safe);
+		return ReadLock<T, Layout, Engine>(thread_safe);
 	}
 
 	template<class ...InputIterator, class>
 	void range_lock(
 		Range<InputIterator>... ranges)
 	{
+		helper::statistics::MultiLockProbe probe(helper::statistics::range_size(ranges...));
+
 		// first, try trivial locking (without reservations).
 		if(helper::try_lock_ranges(ranges...))
+		{
+			probe.acquired();
 			return;
+		}
 
-		// create a ticket.
-		std::random_device rd;
-		std::uniform_int_distribution<ticket_t> dist(0, ~ticket_t(0));
-		ticket_t const ticket = dist(rd);
+		// draw a ticket, kept across retries so that we eventually become the oldest.
+		helper::TicketScope ticket;
 
 		// now try locking via reservations.
 		for(;; std::this_thread::yield())
 		{
 			// try reserving all resources.
-			helper::reserve_ranges(ticket, ranges...);
+			probe.reserved(helper::reserve_ranges(ticket.ticket(), ranges...));
 			// try again to lock everything.
 			if(helper::try_lock_ranges(ranges...))
+			{
+				probe.acquired();
 				return;
+			}
 		}
 	}
 
 	template<class ...T>
 	void multi_lock(T&&... pairs)
 	{
+		helper::statistics::MultiLockProbe probe(sizeof...(T));
+
 		// first, try trivial locking (without reservations).
 		if(helper::try_lock(pairs...))
+		{
+			probe.acquired();
 			return;
+		}
 
-		// create a ticket.
-		std::random_device rd;
-		std::uniform_int_distribution<ticket_t> dist(0, ~ticket_t(0));
-		ticket_t const ticket = dist(rd);
+		// draw a ticket, kept across retries so that we eventually become the oldest.
+		helper::TicketScope ticket;
 
 		// now try locking via reservations.
 		for(;; std::this_thread::yield())
 		{
 			// try reserving all resources.
-			helper::reserve(ticket, pairs.thread_safe...);
+			probe.reserved(helper::reserve(ticket.ticket(), pairs.thread_safe...));
 			// try again to lock everything.
 			if(helper::try_lock(pairs...))
+			{
+				probe.acquired();
 				return;
+			}
 		}
 	}
 
-	template<class ...T>
+	template<class ...T, class ...Layout, class ...Engine>
 	void multi_read_lock(
-		ReadLockPair<T> ... pairs)
+		ReadLockPair<T, Layout, Engine> ... pairs)
 	{
 		multi_lock(pairs...);
 	}
 
-	template<class ...T>
+	template<class ...T, class ...Layout, class ...Engine>
 	void multi_write_lock(
-		WriteLockPair<T> ... pairs)
+		WriteLockPair<T, Layout, Engine> ... pairs)
 	{
 		multi_lock(pairs...);
 	}
 
-	template<class T>
+	template<class ...T>
+	void ordered_multi_lock(
+		T&&... pairs)
+	{
+		helper::Acquisition acquisitions[] = { helper::Acquisition(pairs)... };
+		helper::acquire_ordered(
+			acquisitions,
+			acquisitions + sizeof...(pairs));
+	}
+
+	template<class ...InputIterator, class>
+	void ordered_range_lock(
+		Range<InputIterator>... ranges)
+	{
+		std::vector<helper::Acquisition> acquisitions;
+		helper::collect_ranges(acquisitions, ranges...);
+		helper::acquire_ordered(
+			acquisitions.data(),
+			acquisitions.data() + acquisitions.size());
+	}
+
+	template<class T, class Layout, class Engine>
 	template<class ...Args>
-	ThreadSafe<T>::ThreadSafe(
+	ThreadSafe<T, Layout, Engine>::ThreadSafe(
 		Args&&... args):
-		m_mutex(),
-		m_write_lock(false),
-		m_read_locks(0),
-		m_object(std::forward<Args>(args)...)
+		m_object(std::forward<Args>(args)...),
+		m_engine(),
+		m_reservation(0),
+		m_reservation_wakeups(0),
+		m_version(0),
+		m_combiner(nullptr)
 	{
+#ifdef LOCK_STATISTICS
+		m_readers.store(0, std::memory_order_relaxed);
+#endif
 	}
 
-	template<class T>
-	ThreadSafe<T>::ThreadSafe(
-		ThreadSafe<T> && move):
-		m_mutex(),
-		m_write_lock(false),
-		m_read_locks(0),
-		m_object(std::move(move.m_object))
-	{
-		if(move.m_write_lock || move.m_read_locks.load(std::memory_order_relaxed))
+	template<class T, class Layout, class Engine>
+	ThreadSafe<T, Layout, Engine>::ThreadSafe(
+		ThreadSafe<T, Layout, Engine> && move):
+		m_object(std::move(move.m_object)),
+		m_engine(),
+		m_reservation(0),
+		m_reservation_wakeups(0),
+		m_version(0),
+		m_combiner(nullptr)
+	{
+#ifdef LOCK_STATISTICS
+		m_readers.store(0, std::memory_order_relaxed);
+#endif
+		if(move.m_engine.locked())
 			throw helper::bad_thread_safe_move();
 	}
 
-	template<class T>
-	ThreadSafe<T>::~ThreadSafe()
+	template<class T, class Layout, class Engine>
+	ThreadSafe<T, Layout, Engine>::~ThreadSafe()
 	{
-		assert(!m_write_lock && !m_read_locks);
+		assert(!m_engine.locked());
+		helper::delete_aligned(m_combiner.load(std::memory_order_relaxed), helper::combiner_slots);
 	}
 
-	template<class T>
-	WriteLock<T> ThreadSafe<T>::write()
+	template<class T, class Layout, class Engine>
+	WriteLock<T, Layout, Engine> ThreadSafe<T, Layout, Engine>::write()
 	{
-		std::random_device rd;
-		std::uniform_int_distribution<ticket_t> dist(0, ~ticket_t(0));
-		ticket_t ticket = dist(rd);
+		if(thread_can_claim() && try_lock_write())
+			return WriteLock<T, Layout, Engine>(*this, authorised);
 
-		for(;; std::this_thread::yield())
+		// only draw a ticket and reserve after the initial try failed.
+		helper::TicketScope ticket;
+		lock_write([&] {
+				reserve(ticket.ticket());
+				return thread_can_claim();
+			},
+			helper::statistics::now());
+		unreserve();
+		return WriteLock<T, Layout, Engine>(*this, authorised);
+	}
+
+	template<class T, class Layout, class Engine>
+	WriteLock<T, Layout, Engine> ThreadSafe<T, Layout, Engine>::try_write()
+	{
+		if(thread_can_claim() && try_lock_write())
 		{
-			std::lock_guard<std::mutex> lock(m_mutex);
+			unreserve();
+			return WriteLock<T, Layout, Engine>(*this, authorised);
+		}
+		else
+			return WriteLock<T, Layout, Engine>();
+	}
 
-			if(!m_write_lock
-			&& !m_read_locks.load(std::memory_order_relaxed)
-			&& thread_can_claim())
-			{
-				m_write_lock = true;
-				unreserve();
-				return WriteLock<T>(*this, authorised);
-			}
-			// only reserve after initial try failed.
-			reserve_locked(ticket);
+	template<class T, class Layout, class Engine>
+	ReadLock<T, Layout, Engine> ThreadSafe<T, Layout, Engine>::read()
+	{
+		if(thread_can_claim() && try_lock_read())
+			return ReadLock<T, Layout, Engine>(*this, authorised);
+
+		// only draw a ticket and reserve after the initial try failed.
+		helper::TicketScope ticket;
+		lock_read([&] {
+				reserve(ticket.ticket());
+				return thread_can_claim();
+			},
+			helper::statistics::now());
+		unreserve();
+		return ReadLock<T, Layout, Engine>(*this, authorised);
+	}
+
+	template<class T, class Layout, class Engine>
+	ReadLock<T, Layout, Engine> ThreadSafe<T, Layout, Engine>::try_read()
+	{
+		if(thread_can_claim() && try_lock_read())
+		{
+			unreserve();
+			return ReadLock<T, Layout, Engine>(*this, authorised);
 		}
+		else
+			return ReadLock<T, Layout, Engine>();
 	}
 
-	template<class T>
-	WriteLock<T> ThreadSafe<T>::try_write()
+	template<class T, class Layout, class Engine>
+	UpgradeLock<T, Layout, Engine> ThreadSafe<T, Layout, Engine>::upgradeable_read()
+	{
+		if(thread_can_claim() && try_lock_upgrade())
+			return UpgradeLock<T, Layout, Engine>(*this, authorised);
+
+		// only draw a ticket and reserve after the initial try failed.
+		helper::TicketScope ticket;
+		lock_upgrade([&] {
+				reserve(ticket.ticket());
+				return thread_can_claim();
+			},
+			helper::statistics::now());
+		unreserve();
+		return UpgradeLock<T, Layout, Engine>(*this, authorised);
+	}
+
+	template<class T, class Layout, class Engine>
+	UpgradeLock<T, Layout, Engine> ThreadSafe<T, Layout, Engine>::try_upgradeable_read()
 	{
-		std::lock_guard<std::mutex> lock(m_mutex);
-		if(!m_write_lock
-		&& !m_read_locks.load(std::memory_order_relaxed)
-		&& thread_can_claim())
+		if(thread_can_claim() && try_lock_upgrade())
 		{
-			m_write_lock = true;
 			unreserve();
-			return WriteLock<T>(*this, authorised);
+			return UpgradeLock<T, Layout, Engine>(*this, authorised);
 		}
 		else
-			return WriteLock<T>();
+			return UpgradeLock<T, Layout, Engine>();
 	}
 
-	template<class T>
-	ReadLock<T> ThreadSafe<T>::read()
+	template<class T, class Layout, class Engine>
+	WriteLock<T, Layout, Engine> ThreadSafe<T, Layout, Engine>::write_unreserved()
+	{
+		helper::statistics::timestamp_t const since = helper::statistics::now();
+		if(!try_lock_write())
+			lock_write([] { return true; }, since);
+		return WriteLock<T, Layout, Engine>(*this, authorised);
+	}
+
+	template<class T, class Layout, class Engine>
+	ReadLock<T, Layout, Engine> ThreadSafe<T, Layout, Engine>::read_unreserved()
 	{
-		std::random_device rd;
-		std::uniform_int_distribution<ticket_t> dist(0, ~ticket_t(0));
-		ticket_t ticket = dist(rd);
+		helper::statistics::timestamp_t const since = helper::statistics::now();
+		if(!try_lock_read())
+			lock_read([] { return true; }, since);
+		return ReadLock<T, Layout, Engine>(*this, authorised);
+	}
 
-		for(;; std::this_thread::yield())
+	template<class T, class Layout, class Engine>
+	OptimisticReadLock<T, Layout, Engine> ThreadSafe<T, Layout, Engine>::optimistic_read() const
+	{
+		return OptimisticReadLock<T, Layout, Engine>(*this, stable_version());
+	}
+
+	template<class T, class Layout, class Engine>
+	T ThreadSafe<T, Layout, Engine>::load() const
+	{
+		static_assert(std::is_trivially_copyable<T>::value,
+			"ThreadSafe::load() requires a trivially copyable type.");
+
+		typename std::aligned_storage<sizeof(T), alignof(T)>::type copy;
+		snapshot(&copy);
+		return reinterpret_cast<T const&>(copy);
+	}
+
+	template<class T, class Layout, class Engine>
+	template<class Fn>
+	T ThreadSafe<T, Layout, Engine>::update(
+		Fn &&fn)
+	{
+		static_assert(std::is_trivially_copyable<T>::value,
+			"ThreadSafe::update() requires a trivially copyable type.");
+
+		typename std::aligned_storage<sizeof(T), alignof(T)>::type copy;
+		for(unsigned attempt = 0;; attempt++)
 		{
-			std::lock_guard<std::mutex> lock(m_mutex);
+			std::uint32_t const version = snapshot(&copy);
+			T &value = reinterpret_cast<T &>(copy);
+			fn(value);
 
-			if(!m_write_lock
-			&& thread_can_claim())
+			if(thread_can_claim() && try_lock_write())
 			{
-				m_read_locks.fetch_add(1, std::memory_order_relaxed);
-				unreserve();
-				return ReadLock<T>(*this, authorised);
-			}
+				// acquiring made the version odd: unchanged if nobody wrote in between.
+				bool const unchanged = m_version.load(std::memory_order_relaxed) == version + 1;
+				if(unchanged)
+					std::memcpy(std::addressof(m_object), &copy, sizeof(T));
+				release_write_lock();
 
-			// only reserve after initial try failed.
-			reserve_locked(ticket);
+				if(unchanged)
+					return value;
+			} else
+				wait(attempt, engine::Access::write);
 		}
 	}
 
-	template<class T>
-	ReadLock<T> ThreadSafe<T>::try_read()
+	template<class T, class Layout, class Engine>
+	template<class Fn>
+	auto ThreadSafe<T, Layout, Engine>::apply(
+		Fn &&fn) -> decltype(fn(std::declval<T &>()))
 	{
-		std::lock_guard<std::mutex> lock(m_mutex);
-		if(!m_write_lock
-		&& thread_can_claim())
+		typedef typename std::remove_reference<Fn>::type function_t;
+		typedef decltype(fn(std::declval<T &>())) result_t;
+
+		helper::CombinerCall<T, function_t, result_t> call(fn);
+		helper::CombinerSlot<T> &slot = combiner()[helper::thread_token() & (helper::combiner_slots - 1)];
+
+		helper::CombinerRequest<T> * expected = nullptr;
+		if(!slot.request.compare_exchange_strong(
+			expected,
+			&call,
+			std::memory_order_release,
+			std::memory_order_relaxed))
 		{
-			m_read_locks.fetch_add(1, std::memory_order_relaxed);
-			unreserve();
-			return ReadLock<T>(*this, authorised);
+			// the slot is taken by another thread.
+			WriteLock<T, Layout, Engine> lock = write();
+			return fn(*lock);
+		}
+
+		for(unsigned attempt = 0;; attempt++)
+		{
+			if(call.done.load(std::memory_order_acquire))
+			{
+				// we may have been woken to take the lock, which we no longer need.
+				if(attempt)
+					m_engine.abandon(engine::Access::write);
+				return call.result();
+			}
+
+			// become the combiner: releasing the lock executes all published calls.
+			if(thread_can_claim() && try_lock_write())
+			{
+				release_write_lock();
+				continue;
+			}
+
+			wait(attempt, engine::Access::write);
 		}
-		else
-			return ReadLock<T>();
 	}
 
-	template<class T>
-	void ThreadSafe<T>::reserve(
-		ticket_t priority)
+	template<class T, class Layout, class Engine>
+	bool ThreadSafe<T, Layout, Engine>::reserve(
+		ticket_t ticket)
 	{
-		std::lock_guard<std::mutex> lock(m_mutex);
-		reserve_locked(priority);
+		ticket_t current = m_reservation.load(std::memory_order_relaxed);
+		// older (lower) tickets win.
+		while(!current || ticket < current)
+			if(m_reservation.compare_exchange_weak(
+				current,
+				ticket,
+				std::memory_order_relaxed))
+				return true;
+		return current == ticket;
 	}
 
-	template<class T>
-	bool ThreadSafe<T>::reserved() const
+	template<class T, class Layout, class Engine>
+	bool ThreadSafe<T, Layout, Engine>::reserved() const
 	{
-		return m_reserved_by != std::thread::id();
+		return m_reservation.load(std::memory_order_relaxed) != 0;
 	}
 
-	template<class T>
-	void ThreadSafe<T>::unreserve()
+	template<class T, class Layout, class Engine>
+	void ThreadSafe<T, Layout, Engine>::unreserve()
 	{
-		m_reserved_by = std::thread::id();
+		// only remove our own reservation, others may have reserved in the meantime.
+		ticket_t current = helper::current_ticket();
+		if(!current
+		|| !m_reservation.compare_exchange_strong(
+			current,
+			0,
+			std::memory_order_relaxed))
+			return;
+
+		// pairs with the fence in `await_reservation()`: either the waiter sees the reservation removed, or we see it parked.
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		std::uint32_t wakeups = m_reservation_wakeups.load(std::memory_order_relaxed);
+		// clearing the parked bit carries into the counter.
+		if((wakeups & 1)
+		&& m_reservation_wakeups.compare_exchange_strong(
+			wakeups,
+			wakeups + 1,
+			std::memory_order_relaxed))
+			helper::unpark_all(m_reservation_wakeups);
 	}
 
-	template<class T>
-	bool ThreadSafe<T>::thread_can_claim()
+	template<class T, class Layout, class Engine>
+	bool ThreadSafe<T, Layout, Engine>::thread_can_claim() const
 	{
-		return !reserved() || m_reserved_by == std::this_thread::get_id();
+		ticket_t const current = m_reservation.load(std::memory_order_relaxed);
+		return !current || current == helper::current_ticket();
 	}
 
-	template<class T>
-	void ThreadSafe<T>::reserve_locked(
-		ticket_t priority)
+	template<class T, class Layout, class Engine>
+	void ThreadSafe<T, Layout, Engine>::await_reservation()
+	{
+		std::uint32_t wakeups = m_reservation_wakeups.load(std::memory_order_relaxed);
+		if(!(wakeups & 1)
+		&& !m_reservation_wakeups.compare_exchange_strong(
+			wakeups,
+			wakeups | 1,
+			std::memory_order_relaxed))
+			return;
+
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if(!thread_can_claim())
+			helper::park(m_reservation_wakeups, wakeups | 1);
+	}
+
+	template<class T, class Layout, class Engine>
+	bool ThreadSafe<T, Layout, Engine>::try_lock_write()
+	{
+		if(!m_engine.try_write())
+			return false;
+		acquired_write();
+		return true;
+	}
+
+	template<class T, class Layout, class Engine>
+	bool ThreadSafe<T, Layout, Engine>::try_lock_upgrade()
+	{
+		if(!m_engine.try_upgrade())
+			return false;
+		helper::statistics::acquired(this);
+		return true;
+	}
+
+	template<class T, class Layout, class Engine>
+	template<class Claim>
+	void ThreadSafe<T, Layout, Engine>::lock_write(
+		Claim &&claim,
+		helper::statistics::timestamp_t since)
+	{
+		unsigned attempt = 0;
+		while(!m_engine.lock_write([&] {
+			// every call but the first follows a wait.
+			if(attempt++)
+				helper::statistics::waited(this, attempt - 2);
+			return claim();
+		}))
+			// the engine cannot see reservations, so wait for them here.
+			await_reservation();
+		acquired_write();
+		helper::statistics::contended(this, since);
+	}
+
+	template<class T, class Layout, class Engine>
+	template<class Claim>
+	void ThreadSafe<T, Layout, Engine>::lock_read(
+		Claim &&claim,
+		helper::statistics::timestamp_t since)
+	{
+		unsigned attempt = 0;
+		while(!m_engine.lock_read([&] {
+			if(attempt++)
+				helper::statistics::waited(this, attempt - 2);
+			return claim();
+		}))
+			await_reservation();
+		acquired_read();
+		helper::statistics::contended(this, since);
+	}
+
+	template<class T, class Layout, class Engine>
+	template<class Claim>
+	void ThreadSafe<T, Layout, Engine>::lock_upgrade(
+		Claim &&claim,
+		helper::statistics::timestamp_t since)
+	{
+		unsigned attempt = 0;
+		while(!m_engine.lock_upgrade([&] {
+			if(attempt++)
+				helper::statistics::waited(this, attempt - 2);
+			return claim();
+		}))
+			await_reservation();
+		helper::statistics::acquired(this);
+		helper::statistics::contended(this, since);
+	}
+
+	template<class T, class Layout, class Engine>
+	void ThreadSafe<T, Layout, Engine>::acquired_write()
+	{
+		helper::statistics::acquired(this);
+		begin_hold();
+		begin_write();
+	}
+
+	template<class T, class Layout, class Engine>
+	void ThreadSafe<T, Layout, Engine>::acquired_read()
+	{
+		helper::statistics::acquired(this);
+#ifdef LOCK_STATISTICS
+		// the first reader starts the hold period.
+		if(!m_readers.fetch_add(1, std::memory_order_relaxed))
+			begin_hold();
+#endif
+	}
+
+	template<class T, class Layout, class Engine>
+	void ThreadSafe<T, Layout, Engine>::begin_write()
+	{
+		m_version.store(m_version.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+	}
+
+	template<class T, class Layout, class Engine>
+	WriteLock<T, Layout, Engine> ThreadSafe<T, Layout, Engine>::upgrade()
+	{
+		m_engine.upgrade();
+		begin_hold();
+		begin_write();
+		return WriteLock<T, Layout, Engine>(*this, authorised);
+	}
+
+	template<class T, class Layout, class Engine>
+	ReadLock<T, Layout, Engine> ThreadSafe<T, Layout, Engine>::downgrade()
+	{
+		m_version.store(m_version.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+#ifdef LOCK_STATISTICS
+		// the write lock's hold period continues with the read lock.
+		m_readers.fetch_add(1, std::memory_order_relaxed);
+#endif
+		m_engine.downgrade();
+		return ReadLock<T, Layout, Engine>(*this, authorised);
+	}
+
+	template<class T, class Layout, class Engine>
+	void ThreadSafe<T, Layout, Engine>::release_upgrade_lock()
+	{
+		m_engine.unlock_upgrade();
+	}
+
+	template<class T, class Layout, class Engine>
+	bool ThreadSafe<T, Layout, Engine>::try_lock_read()
+	{
+		if(!m_engine.try_read())
+			return false;
+		acquired_read();
+		return true;
+	}
+
+	template<class T, class Layout, class Engine>
+	void ThreadSafe<T, Layout, Engine>::add_read_lock()
+	{
+#ifdef LOCK_STATISTICS
+		m_readers.fetch_add(1, std::memory_order_relaxed);
+#endif
+		m_engine.add_read();
+	}
+
+	template<class T, class Layout, class Engine>
+	void ThreadSafe<T, Layout, Engine>::release_write_lock()
+	{
+		if(m_combiner.load(std::memory_order_acquire))
+			combine();
+
+		m_version.store(m_version.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+		helper::statistics::held(this, locked_since());
+		m_engine.unlock_write();
+	}
+
+	template<class T, class Layout, class Engine>
+	void ThreadSafe<T, Layout, Engine>::release_read_lock()
 	{
-		if(!reserved() || priority > m_priority)
+#ifdef LOCK_STATISTICS
+		// no new hold period can start before our read lock is released.
+		helper::statistics::timestamp_t const since = locked_since();
+		if(m_readers.fetch_sub(1, std::memory_order_relaxed) == 1)
+			helper::statistics::held(this, since);
+#endif
+		m_engine.unlock_read();
+	}
+
+	template<class T, class Layout, class Engine>
+	void ThreadSafe<T, Layout, Engine>::begin_hold()
+	{
+#ifdef LOCK_STATISTICS
+		m_locked_since.store(helper::statistics::now(), std::memory_order_relaxed);
+#endif
+	}
+
+	template<class T, class Layout, class Engine>
+	helper::statistics::timestamp_t ThreadSafe<T, Layout, Engine>::locked_since() const
+	{
+#ifdef LOCK_STATISTICS
+		return m_locked_since.load(std::memory_order_relaxed);
+#else
+		return 0;
+#endif
+	}
+
+	template<class T, class Layout, class Engine>
+	std::uint32_t ThreadSafe<T, Layout, Engine>::snapshot(
+		void * copy) const
+	{
+		for(;;)
 		{
-			m_reserved_by = std::this_thread::get_id();
-			m_priority = priority;
-		} else if(m_priority == priority)
-			if(m_reserved_by >= std::this_thread::get_id())
-				m_reserved_by = std::this_thread::get_id();
+			std::uint32_t const version = stable_version();
+			std::memcpy(copy, std::addressof(m_object), sizeof(T));
+
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if(m_version.load(std::memory_order_relaxed) == version)
+				return version;
+		}
+	}
+
+	template<class T, class Layout, class Engine>
+	helper::CombinerSlot<T> * ThreadSafe<T, Layout, Engine>::combiner()
+	{
+		helper::CombinerSlot<T> * slots = m_combiner.load(std::memory_order_acquire);
+		if(slots)
+			return slots;
+
+		helper::CombinerSlot<T> * created = helper::new_aligned<helper::CombinerSlot<T>>(helper::combiner_slots);
+		if(m_combiner.compare_exchange_strong(
+			slots,
+			created,
+			std::memory_order_acq_rel,
+			std::memory_order_acquire))
+			return created;
+
+		// another thread was faster.
+		helper::delete_aligned(created, helper::combiner_slots);
+		return slots;
+	}
+
+	template<class T, class Layout, class Engine>
+	void ThreadSafe<T, Layout, Engine>::combine()
+	{
+		helper::CombinerSlot<T> * slots = m_combiner.load(std::memory_order_acquire);
+		for(std::size_t i = 0; i < helper::combiner_slots; i++)
+			if(helper::CombinerRequest<T> * request = slots[i].request.exchange(nullptr, std::memory_order_acquire))
+			{
+				request->execute(*request, m_object);
+				// the requester may return as soon as it sees this.
+				request->done.store(true, std::memory_order_release);
+			}
+	}
+
+	template<class T, class Layout, class Engine>
+	std::uint32_t ThreadSafe<T, Layout, Engine>::stable_version() const
+	{
+		for(unsigned attempt = 0;; attempt++)
+		{
+			std::uint32_t const version = m_version.load(std::memory_order_acquire);
+			if(!(version & 1))
+				return version;
+
+			if(attempt < helper::spin_attempts)
+				helper::cpu_relax();
+			else
+				std::this_thread::yield();
+		}
+	}
+
+	template<class T, class Layout, class Engine>
+	void ThreadSafe<T, Layout, Engine>::wait(
+		unsigned attempt,
+		engine::Access access)
+	{
+		helper::statistics::waited(this, attempt);
+		if(thread_can_claim())
+			m_engine.wait(attempt, access);
+		else
+		{
+			m_engine.abandon(access);
+			await_reservation();
+		}
 	}
-}
\ No newline at end of file
+}
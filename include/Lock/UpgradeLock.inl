@@ -0,0 +1,119 @@
+namespace lock
+{
+	template<class T, class Layout, class Engine>
+	UpgradeLock<T, Layout, Engine>::UpgradeLock(
+		ThreadSafe<T, Layout, Engine> &proxy,
+		typename ThreadSafe<T, Layout, Engine>::Authorised):
+		m_proxy(&proxy)
+	{
+	}
+
+	template<class T, class Layout, class Engine>
+	UpgradeLock<T, Layout, Engine>::UpgradeLock():
+		m_proxy(nullptr)
+	{
+	}
+
+	template<class T, class Layout, class Engine>
+	UpgradeLock<T, Layout, Engine>::UpgradeLock(
+		ThreadSafe<T, Layout, Engine> &proxy):
+		UpgradeLock(proxy.upgradeable_read())
+	{
+	}
+
+	template<class T, class Layout, class Engine>
+	UpgradeLock<T, Layout, Engine>::UpgradeLock(
+		UpgradeLock<T, Layout, Engine> &&move):
+		m_proxy(move.m_proxy)
+	{
+		move.m_proxy = nullptr;
+	}
+
+	template<class T, class Layout, class Engine>
+	UpgradeLock<T, Layout, Engine>::~UpgradeLock()
+	{
+		if(locked())
+			m_proxy->release_upgrade_lock();
+	}
+
+	template<class T, class Layout, class Engine>
+	UpgradeLock<T, Layout, Engine> &UpgradeLock<T, Layout, Engine>::operator=(
+		UpgradeLock<T, Layout, Engine> &&move)
+	{
+		if(&move == this)
+			return *this;
+
+		if(locked())
+			m_proxy->release_upgrade_lock();
+
+		m_proxy = move.m_proxy;
+		move.m_proxy = nullptr;
+
+		return *this;
+	}
+
+	template<class T, class Layout, class Engine>
+	T const * UpgradeLock<T, Layout, Engine>::operator->() const
+	{
+		assert(locked()
+			&& "Tried to access empty lock.");
+
+		return std::addressof(m_proxy->m_object);
+	}
+
+	template<class T, class Layout, class Engine>
+	T const& UpgradeLock<T, Layout, Engine>::operator*() const
+	{
+		assert(locked()
+			&& "Tried to access empty lock.");
+
+		return m_proxy->m_object;
+	}
+
+	template<class T, class Layout, class Engine>
+	bool UpgradeLock<T, Layout, Engine>::locked() const
+	{
+		return m_proxy != nullptr;
+	}
+
+	template<class T, class Layout, class Engine>
+	UpgradeLock<T, Layout, Engine>::operator bool() const
+	{
+		return locked();
+	}
+
+	template<class T, class Layout, class Engine>
+	void UpgradeLock<T, Layout, Engine>::lock(
+		ThreadSafe<T, Layout, Engine> &proxy)
+	{
+		*this = proxy.upgradeable_read();
+	}
+
+	template<class T, class Layout, class Engine>
+	bool UpgradeLock<T, Layout, Engine>::try_lock(
+		ThreadSafe<T, Layout, Engine> &proxy)
+	{
+		return *this = proxy.try_upgradeable_read();
+	}
+
+	template<class T, class Layout, class Engine>
+	void UpgradeLock<T, Layout, Engine>::unlock()
+	{
+		assert(locked()
+			&& "Tried to unlock empty lock.");
+
+		m_proxy->release_upgrade_lock();
+		m_proxy = nullptr;
+	}
+
+	template<class T, class Layout, class Engine>
+	WriteLock<T, Layout, Engine> UpgradeLock<T, Layout, Engine>::upgrade()
+	{
+		assert(locked()
+			&& "Tried to upgrade empty lock.");
+
+		ThreadSafe<T, Layout, Engine> * proxy = m_proxy;
+		m_proxy = nullptr;
+		return proxy->upgrade();
+	}
+}
\ No newline at end of file
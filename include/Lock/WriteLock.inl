@@ -1,50 +1,50 @@
 namespace lock
 {
-	template<class T>
-	WriteLock<T>::WriteLock(
-		ThreadSafe<T> &proxy,
-		typename ThreadSafe<T>::Authorised):
+	template<class T, class Layout, class Engine>
+	WriteLock<T, Layout, Engine>::WriteLock(
+		ThreadSafe<T, Layout, Engine> &proxy,
+		typename ThreadSafe<T, Layout, Engine>::Authorised):
 		m_proxy(&proxy)
 	{
 	}
 
-	template<class T>
-	WriteLock<T>::WriteLock():
+	template<class T, class Layout, class Engine>
+	WriteLock<T, Layout, Engine>::WriteLock():
 		m_proxy(nullptr)
 	{
 	}
 
-	template<class T>
-	WriteLock<T>::WriteLock(
-		ThreadSafe<T> &proxy):
+	template<class T, class Layout, class Engine>
+	WriteLock<T, Layout, Engine>::WriteLock(
+		ThreadSafe<T, Layout, Engine> &proxy):
 		WriteLock(proxy.write())
 	{
 	}
 
-	template<class T>
-	WriteLock<T>::WriteLock(
-		WriteLock<T> &&move):
+	template<class T, class Layout, class Engine>
+	WriteLock<T, Layout, Engine>::WriteLock(
+		WriteLock<T, Layout, Engine> &&move):
 		m_proxy(move.m_proxy)
 	{
 		move.m_proxy = nullptr;
 	}
 
-	template<class T>
-	WriteLock<T>::~WriteLock()
+	template<class T, class Layout, class Engine>
+	WriteLock<T, Layout, Engine>::~WriteLock()
 	{
 		if(locked())
-			m_proxy->m_write_lock = false;
+			m_proxy->release_write_lock();
 	}
 
-	template<class T>
-	WriteLock<T> &WriteLock<T>::operator=(
-		WriteLock<T> &&move)
+	template<class T, class Layout, class Engine>
+	WriteLock<T, Layout, Engine> &WriteLock<T, Layout, Engine>::operator=(
+		WriteLock<T, Layout, Engine> &&move)
 	{
 		if(&move == this)
 			return *this;
 
 		if(locked())
-			m_proxy->m_write_lock = false;
+			m_proxy->release_write_lock();
 
 		m_proxy = move.m_proxy;
 		move.m_proxy = nullptr;
@@ -52,8 +52,8 @@ namespace lock
 		return *this;
 	}
 
-	template<class T>
-	T * WriteLock<T>::operator->() const
+	template<class T, class Layout, class Engine>
+	T * WriteLock<T, Layout, Engine>::operator->() const
 	{
 		assert(locked()
 			&& "Tried to access empty lock.");
@@ -61,8 +61,8 @@ namespace lock
 		return std::addressof(m_proxy->m_object);
 	}
 
-	template<class T>
-	T & WriteLock<T>::operator*() const
+	template<class T, class Layout, class Engine>
+	T & WriteLock<T, Layout, Engine>::operator*() const
 	{
 		assert(locked()
 			&& "Tried to access empty lock.");
@@ -70,39 +70,50 @@ namespace lock
 		return m_proxy->m_object;
 	}
 
-	template<class T>
-	bool WriteLock<T>::locked() const
+	template<class T, class Layout, class Engine>
+	bool WriteLock<T, Layout, Engine>::locked() const
 	{
 		return m_proxy != nullptr;
 	}
 
-	template<class T>
-	void WriteLock<T>::lock(
-		ThreadSafe<T> & proxy)
+	template<class T, class Layout, class Engine>
+	void WriteLock<T, Layout, Engine>::lock(
+		ThreadSafe<T, Layout, Engine> & proxy)
 	{
 		*this = proxy.write();
 	}
 
-	template<class T>
-	bool WriteLock<T>::try_lock(
-		ThreadSafe<T> &proxy)
+	template<class T, class Layout, class Engine>
+	bool WriteLock<T, Layout, Engine>::try_lock(
+		ThreadSafe<T, Layout, Engine> &proxy)
 	{
 		return *this = proxy.try_write();
 	}
 
-	template<class T>
-	WriteLock<T>::operator bool() const
+	template<class T, class Layout, class Engine>
+	WriteLock<T, Layout, Engine>::operator bool() const
 	{
 		return locked();
 	}
 
-	template<class T>
-	void WriteLock<T>::unlock()
+	template<class T, class Layout, class Engine>
+	void WriteLock<T, Layout, Engine>::unlock()
 	{
 		assert(locked() &&
 			"Tried to unlock empty lock.");
 
-		m_proxy->m_write_lock = false;
+		m_proxy->release_write_lock();
 		m_proxy = nullptr;
 	}
+
+	template<class T, class Layout, class Engine>
+	ReadLock<T, Layout, Engine> WriteLock<T, Layout, Engine>::downgrade()
+	{
+		assert(locked()
+			&& "Tried to downgrade empty lock.");
+
+		ThreadSafe<T, Layout, Engine> * proxy = m_proxy;
+		m_proxy = nullptr;
+		return proxy->downgrade();
+	}
 }
\ No newline at end of file